@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+/**
+ * @brief Synthetic scene used as input for the benchmarks.
+ *
+ * Objects move with constant velocity and a little noise. Each frame a given
+ * fraction of the objects leaves the scene and is replaced by new ones (churn).
+ * Class IDs follow a Zipf distribution, which resembles the skewed class
+ * frequencies of datasets like COCO (many persons, few toothbrushes).
+ */
+class BenchmarkScene
+{
+	struct Object
+	{
+		uint32_t classID;
+		BBox box;
+		float vx, vy;
+	};
+
+public:
+	BenchmarkScene(const std::size_t& objectCount, const std::size_t& classCount, const double& churnPercent, const uint32_t& seed = 42) :
+		m_classCount(std::max<std::size_t>(classCount, 1)),
+		m_churn(churnPercent / 100.0),
+		m_rng(seed),
+		m_classDist(makeZipf(m_classCount)),
+		m_objects(),
+		m_dets(),
+		m_classes(),
+		m_classNames()
+	{
+		for (std::size_t i = 0; i < m_classCount; i++)
+			m_classNames.push_back("class" + std::to_string(i));
+
+		for (std::size_t i = 0; i < objectCount; i++)
+			m_objects.push_back(newObject());
+	}
+
+	/**
+	 * @brief Advance the scene by one frame.
+	 */
+	void Step()
+	{
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		std::normal_distribution<float> noise(0.0f, 0.002f);
+
+		for (Object& obj : m_objects)
+		{
+			if (chance(m_rng) < m_churn)
+			{
+				obj = newObject();
+				continue;
+			}
+
+			obj.box.x += obj.vx + noise(m_rng);
+			obj.box.y += obj.vy + noise(m_rng);
+
+			if (obj.box.x < 0.0f || obj.box.x + obj.box.width > 1.0f) obj.vx = -obj.vx;
+			if (obj.box.y < 0.0f || obj.box.y + obj.box.height > 1.0f) obj.vy = -obj.vy;
+
+			obj.box.x = std::clamp(obj.box.x, 0.0f, 1.0f - obj.box.width);
+			obj.box.y = std::clamp(obj.box.y, 0.0f, 1.0f - obj.box.height);
+		}
+
+		m_dets.clear();
+		m_classes.clear();
+		for (const Object& obj : m_objects)
+		{
+			m_dets.push_back(TrackingObject(obj.box, 90, 0, obj.classID + 1));
+			m_classes.push_back(obj.classID);
+		}
+	}
+
+	// Detections of the current frame
+	const TrackingObjects& GetDetections() const
+	{
+		return m_dets;
+	}
+
+	// 0-based class index of each detection of the current frame
+	const std::vector<uint32_t>& GetClasses() const
+	{
+		return m_classes;
+	}
+
+	const std::size_t& GetClassCount() const
+	{
+		return m_classCount;
+	}
+
+	// Names of the classes as in a class file, indexed by the 1-based class ID minus one
+	const std::vector<std::string>& GetClassNames() const
+	{
+		return m_classNames;
+	}
+
+private:
+	static std::discrete_distribution<uint32_t> makeZipf(const std::size_t& classCount)
+	{
+		std::vector<double> weights;
+		for (std::size_t i = 0; i < classCount; i++)
+			weights.push_back(1.0 / static_cast<double>(i + 1));
+		return std::discrete_distribution<uint32_t>(weights.begin(), weights.end());
+	}
+
+	Object newObject()
+	{
+		std::uniform_real_distribution<float> size(0.02f, 0.1f);
+		std::uniform_real_distribution<float> vel(-0.005f, 0.005f);
+
+		float w = size(m_rng);
+		float h = size(m_rng);
+		std::uniform_real_distribution<float> posX(0.0f, 1.0f - w);
+		std::uniform_real_distribution<float> posY(0.0f, 1.0f - h);
+
+		return { m_classDist(m_rng), BBox(posX(m_rng), posY(m_rng), w, h), vel(m_rng), vel(m_rng) };
+	}
+
+private:
+	std::size_t m_classCount;
+	double m_churn;
+	std::mt19937 m_rng;
+	std::discrete_distribution<uint32_t> m_classDist;
+	std::vector<Object> m_objects;
+	TrackingObjects m_dets;
+	std::vector<uint32_t> m_classes;
+	std::vector<std::string> m_classNames;
+};
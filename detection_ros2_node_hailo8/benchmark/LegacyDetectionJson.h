@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "DetectionJson.h"
+#include "Types.h"
+#include "Utils.h"
+
+// Serialization as done before the JsonWriter, kept as a baseline for the benchmarks
+
+/**
+ * @brief Build the detection JSON with std::stringstream and one string_format call per object.
+ */
+inline std::string LegacyBuildDetectionJson(const std::string& detectStr, const std::string& amountStr, const TrackingObjects& trackers, const std::vector<std::string>& classNames)
+{
+	std::stringstream str("");
+	str << string_format("{\"%s\": [", detectStr.c_str());
+
+	for (const auto& [i, t] : enumerate(trackers))
+	{
+		BBox centerBox = ToCenter(t.bBox);
+		str << string_format("{\"TrackID\": %i, \"name\": \"%s\", \"center\": [%.3f,%.3f], \"w_h\": [%.3f,%.3f]}", t.trackingID, GetClassName(classNames, t.classID).c_str(), roundf(centerBox.x*1000.0f)/1000.0f , roundf(centerBox.y*1000.0f)/1000.0f, roundf(centerBox.width*1000.0f)/1000.0f, roundf(centerBox.height*1000.0f)/1000.0f);
+		// Prevent a trailing ',' for the last element
+		if (i + 1 < trackers.size()) str << ", ";
+	}
+
+	str << string_format("], \"%s\": %llu }", amountStr.c_str(), trackers.size());
+
+	return str.str();
+}
+
+/**
+ * @brief Build the FPS JSON with std::stringstream and string_format.
+ */
+inline std::string LegacyBuildFpsJson(const std::string& fpsStr, const float& fps, const float& itrTime, const double& maxFPS, const uint64_t& droppedFrames, const double& queueAgeMSec,
+									  const std::string& amountStr, const std::size_t& amount)
+{
+	std::stringstream str("");
+
+	if (fps == 0.0f)
+		str << string_format("{\"%s\": 0.0}", fpsStr.c_str());
+	else
+		str << string_format("{\"%s\": %.2f, \"lastCurrMSec\": %.2f, \"maxFPS\": %.2f, \"droppedFrames\": %llu, \"queueAgeMSec\": %.2f, \"%s\": %llu }", fpsStr.c_str(), fps, itrTime, maxFPS,
+							 droppedFrames, queueAgeMSec, amountStr.c_str(), amount);
+
+	return str.str();
+}
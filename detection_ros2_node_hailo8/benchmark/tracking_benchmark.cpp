@@ -0,0 +1,516 @@
+// Micro-benchmarks for the non-inference hot path: SORT, assignment, Kalman filter and JSON building.
+//
+// Machine-readable output:
+//   ./detection_benchmarks --benchmark_format=json --benchmark_out=benchmark_results.json
+// or use the "run_benchmarks" build target.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "BenchmarkScene.h"
+#include "DetectionJson.h"
+#include "InferencePool.h"
+#include "KalmanBoxTracker.h"
+#include "LatencyHistogram.h"
+#include "LegacyDetectionJson.h"
+#include "LinearAssignment.h"
+#include "MockDetector.h"
+#include "NonMaxSuppression.h"
+#include "Preprocessor.h"
+#include "SORT.h"
+#include "SparseAssociation.h"
+#include "TileLayout.h"
+#include "TrackBank.h"
+
+// Objects / tracks per frame
+static const std::vector<int64_t> OBJECT_COUNTS = { 1, 10, 50, 100, 250, 500 };
+// Number of classes in the class file (single class vs. COCO)
+static const std::vector<int64_t> CLASS_COUNTS = { 1, 80 };
+// Percentage of objects replaced per frame
+static const std::vector<int64_t> CHURN_RATES = { 0, 10 };
+
+static void SetCounters(benchmark::State& state, const std::size_t& items)
+{
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(items));
+	state.counters["objects"] = static_cast<double>(items);
+}
+
+// One frame of tracking as done by the node: one class-aware SORT instance for the detections of all classes
+static void BM_SORT_Update(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), state.range(1), static_cast<double>(state.range(2)));
+	SORT tracker(30, 5);
+	TrackingObjects tracks; // Reused output buffer, as kept per model by the node
+
+	// Warm up so the tracker is populated
+	for (int i = 0; i < 10; i++)
+	{
+		scene.Step();
+		tracker.Update(scene.GetDetections(), tracks);
+	}
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		scene.Step();
+		state.ResumeTiming();
+
+		tracker.Update(scene.GetDetections(), tracks);
+		benchmark::DoNotOptimize(tracks.data());
+	}
+
+	SetCounters(state, static_cast<std::size_t>(state.range(0)));
+}
+BENCHMARK(BM_SORT_Update)->ArgsProduct({ OBJECT_COUNTS, CLASS_COUNTS, CHURN_RATES })->ArgNames({ "objects", "classes", "churn" })->Unit(benchmark::kMicrosecond);
+
+// Row-major IOU cost matrix of tracks vs. detections as built in SORT::Update
+static std::vector<float> BuildCostMatrix(BenchmarkScene& scene)
+{
+	scene.Step();
+	const TrackingObjects prev = scene.GetDetections();
+	scene.Step();
+	const TrackingObjects& curr = scene.GetDetections();
+
+	std::vector<float> cost(prev.size() * curr.size(), 1.0f);
+	for (std::size_t i = 0; i < prev.size(); i++)
+	{
+		for (std::size_t j = 0; j < curr.size(); j++)
+		{
+			float in                  = (prev[i].bBox & curr[j].bBox).area();
+			float un                  = prev[i].bBox.area() + curr[j].bBox.area() - in;
+			cost[i * curr.size() + j] = un > 0.0f ? 1.0f - in / un : 1.0f;
+		}
+	}
+
+	return cost;
+}
+
+// With churn, replaced objects overlap no track and the general solver is used instead of the row minima fast path
+static void BM_LinearAssignment_Solve(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, static_cast<double>(state.range(1)));
+	const std::size_t n           = static_cast<std::size_t>(state.range(0));
+	const std::vector<float> cost = BuildCostMatrix(scene);
+	LinearAssignment solver;
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(solver.Solve(cost.data(), n, n).data());
+
+	SetCounters(state, n);
+}
+BENCHMARK(BM_LinearAssignment_Solve)->ArgsProduct({ OBJECT_COUNTS, CHURN_RATES })->ArgNames({ "objects", "churn" })->Unit(benchmark::kMicrosecond);
+
+// Gated association of the previous frame's boxes with the current detections, including the candidate search
+static void BM_SparseAssociation_Associate(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, static_cast<double>(state.range(1)));
+	scene.Step();
+
+	BBoxes tracks;
+	for (const TrackingObject& det : scene.GetDetections())
+		tracks.push_back(det.bBox);
+
+	scene.Step();
+	const TrackingObjects& dets = scene.GetDetections();
+	SparseAssociation association;
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(association.Associate(tracks, nullptr, dets, 0.5f).data());
+
+	SetCounters(state, dets.size());
+	state.counters["candidates"] = static_cast<double>(association.GetCandidateCount());
+}
+BENCHMARK(BM_SparseAssociation_Associate)->ArgsProduct({ { 1, 10, 50, 100, 250, 500, 1000 }, CHURN_RATES })->ArgNames({ "objects", "churn" })->Unit(benchmark::kMicrosecond);
+
+static void BM_KalmanBoxTracker_Predict(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, 0.0);
+	scene.Step();
+
+	std::vector<KalmanBoxTracker> trackers;
+	for (const TrackingObject& det : scene.GetDetections())
+		trackers.push_back(KalmanBoxTracker(det.bBox, det.classID));
+
+	for (auto _ : state)
+	{
+		for (KalmanBoxTracker& trk : trackers)
+			benchmark::DoNotOptimize(trk.Predict());
+	}
+
+	SetCounters(state, trackers.size());
+}
+BENCHMARK(BM_KalmanBoxTracker_Predict)->ArgsProduct({ OBJECT_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+static void BM_KalmanBoxTracker_Update(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, 0.0);
+	scene.Step();
+
+	std::vector<KalmanBoxTracker> trackers;
+	for (const TrackingObject& det : scene.GetDetections())
+		trackers.push_back(KalmanBoxTracker(det.bBox, det.classID));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		scene.Step();
+		for (KalmanBoxTracker& trk : trackers)
+			trk.Predict();
+		state.ResumeTiming();
+
+		const TrackingObjects& dets = scene.GetDetections();
+		for (std::size_t i = 0; i < trackers.size(); i++)
+			trackers[i].Update(dets[i].bBox, dets[i].classID);
+	}
+
+	SetCounters(state, trackers.size());
+}
+BENCHMARK(BM_KalmanBoxTracker_Update)->ArgsProduct({ OBJECT_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+static void BM_KalmanBoxTracker_Create(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, 0.0);
+	scene.Step();
+	const TrackingObjects& dets = scene.GetDetections();
+
+	for (auto _ : state)
+	{
+		std::vector<KalmanBoxTracker> trackers;
+		trackers.reserve(dets.size());
+		for (const TrackingObject& det : dets)
+			trackers.push_back(KalmanBoxTracker(det.bBox, det.classID));
+		benchmark::DoNotOptimize(trackers.data());
+	}
+
+	SetCounters(state, dets.size());
+}
+BENCHMARK(BM_KalmanBoxTracker_Create)->ArgsProduct({ OBJECT_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+// Track counts for the structure-of-arrays track bank, up to crowded scenes
+static const std::vector<int64_t> BANK_TRACK_COUNTS = { 1, 10, 50, 100, 250, 500, 1000 };
+
+// Batched predict of all tracks, compare with BM_KalmanBoxTracker_Predict
+static void BM_TrackBank_Predict(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, 0.0);
+	scene.Step();
+
+	TrackBank bank;
+	for (const TrackingObject& det : scene.GetDetections())
+		bank.Add(det.bBox, det.classID);
+
+	BBoxes predicted;
+	for (auto _ : state)
+	{
+		bank.Predict(predicted);
+		benchmark::DoNotOptimize(predicted.data());
+	}
+
+	SetCounters(state, bank.Size());
+}
+BENCHMARK(BM_TrackBank_Predict)->ArgsProduct({ BANK_TRACK_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+// Batched correction of all tracks, compare with BM_KalmanBoxTracker_Update
+static void BM_TrackBank_Update(benchmark::State& state)
+{
+	BenchmarkScene scene(state.range(0), 1, 0.0);
+	scene.Step();
+
+	TrackBank bank;
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	for (const TrackingObject& det : scene.GetDetections())
+	{
+		pairs.push_back({ static_cast<uint32_t>(bank.Size()), static_cast<uint32_t>(bank.Size()) });
+		bank.Add(det.bBox, det.classID);
+	}
+
+	BBoxes predicted;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		scene.Step();
+		bank.Predict(predicted);
+		state.ResumeTiming();
+
+		bank.Update(pairs, scene.GetDetections());
+	}
+
+	SetCounters(state, bank.Size());
+}
+BENCHMARK(BM_TrackBank_Update)->ArgsProduct({ BANK_TRACK_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+// JSON building as done in ModelTracks::WriteJson
+static TrackingObjects makeJsonTracks(const int64_t& count, std::vector<std::string>& classNames)
+{
+	BenchmarkScene scene(count, 80, 0.0);
+	scene.Step();
+
+	TrackingObjects tracks = scene.GetDetections();
+	for (std::size_t i = 0; i < tracks.size(); i++)
+		tracks[i].trackingID = static_cast<uint32_t>(i + 1);
+
+	classNames = scene.GetClassNames();
+	return tracks;
+}
+
+// Previous stringstream based serialization, kept as baseline
+static void BM_LegacyDetectionJson(benchmark::State& state)
+{
+	std::vector<std::string> classNames;
+	const TrackingObjects tracks = makeJsonTracks(state.range(0), classNames);
+
+	std::size_t bytes = 0;
+	for (auto _ : state)
+	{
+		std::string json = LegacyBuildDetectionJson("DETECTED_OBJECTS", "DETECTED_OBJECTS_AMOUNT", tracks, classNames);
+		bytes            = json.size();
+		benchmark::DoNotOptimize(json.data());
+	}
+
+	SetCounters(state, tracks.size());
+	state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_LegacyDetectionJson)->ArgsProduct({ OBJECT_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+static void BM_WriteDetectionJson(benchmark::State& state)
+{
+	std::vector<std::string> classNames;
+	const TrackingObjects tracks = makeJsonTracks(state.range(0), classNames);
+	const std::string detectStr  = "DETECTED_OBJECTS";
+	const std::string amountStr  = "DETECTED_OBJECTS_AMOUNT";
+
+	std::string json;
+	for (auto _ : state)
+	{
+		WriteDetectionJson(json, detectStr, amountStr, tracks, classNames);
+		benchmark::DoNotOptimize(json.data());
+	}
+
+	SetCounters(state, tracks.size());
+	state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_WriteDetectionJson)->ArgsProduct({ OBJECT_COUNTS })->ArgNames({ "tracks" })->Unit(benchmark::kMicrosecond);
+
+static void BM_LegacyFpsJson(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		std::string json = LegacyBuildFpsJson("OBJECT_DET_FPS", 29.95f, 28.89f, 30.0, 12, 0.41, "DETECTED_OBJECTS_AMOUNT", 3);
+		benchmark::DoNotOptimize(json.data());
+	}
+}
+BENCHMARK(BM_LegacyFpsJson);
+
+static void BM_WriteFpsJson(benchmark::State& state)
+{
+	const std::string fpsStr    = "OBJECT_DET_FPS";
+	const std::string amountStr = "DETECTED_OBJECTS_AMOUNT";
+
+	FpsStats stats;
+	stats.fps           = 29.95f;
+	stats.itrTime       = 28.89f;
+	stats.maxFPS        = 30.0;
+	stats.droppedFrames = 12;
+	stats.queueAgeMSec  = 0.41;
+	stats.amount        = 3;
+
+	std::string json;
+	for (auto _ : state)
+	{
+		WriteFpsJson(json, fpsStr, amountStr, stats);
+		benchmark::DoNotOptimize(json.data());
+	}
+}
+BENCHMARK(BM_WriteFpsJson);
+
+// Cost of timing one stage, two clock reads and one histogram update
+static void BM_ScopedLatency(benchmark::State& state)
+{
+	LatencyHistogram histogram;
+	for (auto _ : state)
+	{
+		ScopedLatency latency(histogram);
+		benchmark::ClobberMemory();
+	}
+
+	benchmark::DoNotOptimize(histogram.Snapshot());
+}
+BENCHMARK(BM_ScopedLatency);
+
+// Fused conversion, rotation and letterbox resize of a 1280x720 frame into a 640x640 network input
+static void BM_Preprocess(benchmark::State& state)
+{
+	const Preprocessor::Encoding encoding = static_cast<Preprocessor::Encoding>(state.range(0));
+	const uint32_t rotation              = static_cast<uint32_t>(state.range(1));
+
+	Preprocessor::Frame frame = { nullptr, 1280, 720, 1280 * Preprocessor::GetBytesPerPixel(encoding), encoding };
+	std::vector<uint8_t> data(Preprocessor::GetRequiredBytes(frame));
+	for (std::size_t i = 0; i < data.size(); i++)
+		data[i] = static_cast<uint8_t>(i * 31 + i / 4093);
+	frame.data = data.data();
+
+	Preprocessor preprocessor(640, true);
+	for (auto _ : state)
+	{
+		preprocessor.Process(frame, rotation);
+		benchmark::DoNotOptimize(preprocessor.GetData());
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+}
+BENCHMARK(BM_Preprocess)
+	->ArgsProduct({ { static_cast<int64_t>(Preprocessor::Encoding::BGR8), static_cast<int64_t>(Preprocessor::Encoding::RGB8), static_cast<int64_t>(Preprocessor::Encoding::UYVY),
+					  static_cast<int64_t>(Preprocessor::Encoding::NV12) },
+					{ 0, 90 } })
+	->ArgNames({ "encoding", "rotation" })
+	->Unit(benchmark::kMicrosecond);
+
+// Preprocessing of all tiles of a 3840x2160 frame into 640x640 network inputs, per tile layout
+static void BM_PreprocessTiled(benchmark::State& state)
+{
+	const TileLayout layout(static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1)), 0.2f, state.range(2) != 0);
+
+	Preprocessor::Frame frame = { nullptr, 3840, 2160, 3840 * 3, Preprocessor::Encoding::BGR8 };
+	std::vector<uint8_t> data(Preprocessor::GetRequiredBytes(frame));
+	for (std::size_t i = 0; i < data.size(); i++)
+		data[i] = static_cast<uint8_t>(i * 31 + i / 4093);
+	frame.data = data.data();
+
+	std::vector<Preprocessor::Region> tiles;
+	layout.Compute(frame.width, frame.height, tiles);
+	std::vector<Preprocessor> preprocessors(tiles.size(), Preprocessor(640, true));
+
+	for (auto _ : state)
+	{
+		for (std::size_t t = 0; t < tiles.size(); t++)
+		{
+			preprocessors[t].Process(frame, 0, tiles[t]);
+			benchmark::DoNotOptimize(preprocessors[t].GetData());
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.counters["tiles"]   = static_cast<double>(tiles.size());
+	state.counters["tiles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * tiles.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PreprocessTiled)
+	->Args({ 1, 1, 0 })
+	->Args({ 2, 1, 1 })
+	->Args({ 2, 2, 0 })
+	->Args({ 2, 2, 1 })
+	->Args({ 3, 2, 1 })
+	->Args({ 4, 3, 1 })
+	->ArgNames({ "cols", "rows", "full" })
+	->Unit(benchmark::kMicrosecond);
+
+// Merging the detections of a 2x2 tiling with full view, every object is detected in up to three different tiles
+static void BM_NonMaxSuppression(benchmark::State& state)
+{
+	const std::size_t objects = static_cast<std::size_t>(state.range(0));
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> pos(0.0f, 0.95f);
+	std::uniform_real_distribution<float> jitter(-0.002f, 0.002f);
+	std::uniform_int_distribution<uint32_t> cls(1, 80);
+
+	Detections input;
+	for (std::size_t i = 0; i < objects; i++)
+	{
+		const Detection det = { cls(rng), pos(rng), pos(rng), 0.03f, 0.05f, 0.5f };
+		for (uint32_t copy = 0; copy < 1 + rng() % 3; copy++)
+			input.push_back({ det.classID, det.x + jitter(rng), det.y + jitter(rng), det.w, det.h, 0.5f + 0.1f * static_cast<float>(copy), copy });
+	}
+
+	NonMaxSuppression nms;
+	Detections dets;
+	for (auto _ : state)
+	{
+		dets = input;
+		nms.Apply(dets, 0.5f);
+		benchmark::DoNotOptimize(dets.data());
+	}
+
+	SetCounters(state, input.size());
+}
+BENCHMARK(BM_NonMaxSuppression)->ArgsProduct({ OBJECT_COUNTS })->ArgNames({ "objects" })->Unit(benchmark::kMicrosecond);
+
+// Throughput of a pool of mock devices with 2 ms inference each, results delivered in frame order
+static void BM_InferencePool(benchmark::State& state)
+{
+	const std::size_t devices = static_cast<std::size_t>(state.range(0));
+	const auto scheduling     = state.range(1) ? InferencePool<uint64_t>::Scheduling::LEAST_LOADED : InferencePool<uint64_t>::Scheduling::ROUND_ROBIN;
+
+	const auto frameCounter = std::make_shared<std::atomic<uint64_t>>(0);
+	std::vector<std::unique_ptr<MockDetector>> detectors;
+	for (std::size_t i = 0; i < devices; i++)
+		detectors.push_back(std::make_unique<MockDetector>("", 2.0, 0.0, 10, 42, "", frameCounter));
+
+	uint64_t delivered = 0;
+	uint64_t reordered = 0;
+	cv::Mat input;
+
+	InferencePool<uint64_t> pool(
+		devices, scheduling, [&detectors, &input](const std::size_t& w, uint64_t& frame) { benchmark::DoNotOptimize(detectors[w]->Infer(input).size() + frame); },
+		[&delivered, &reordered](uint64_t& frame) {
+			if (frame != delivered) reordered++;
+			delivered++;
+		});
+
+	uint64_t frame = 0;
+	for (auto _ : state)
+	{
+		pool.WaitForWorker();
+		pool.Submit(uint64_t(frame++));
+	}
+	pool.Stop();
+
+	state.counters["devices"]   = static_cast<double>(devices);
+	state.counters["reordered"] = static_cast<double>(reordered);
+	state.SetItemsProcessed(static_cast<int64_t>(frame));
+}
+BENCHMARK(BM_InferencePool)->ArgsProduct({ { 1, 2, 4 }, { 0, 1 } })->ArgNames({ "devices", "leastLoaded" })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// One mock device with 2 ms inference and 2 ms of host work per frame, the workers share the device
+static void BM_FramesInFlight(benchmark::State& state)
+{
+	const std::size_t inFlight = static_cast<std::size_t>(state.range(0));
+
+	MockDetector detector("", 2.0, 0.0, 10, 42);
+	std::mutex device;
+	cv::Mat input;
+
+	// Host work (preprocessing and post-processing) keeps the CPU busy instead of sleeping
+	auto hostWork = [] {
+		const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+		while (std::chrono::steady_clock::now() < end)
+			;
+	};
+
+	InferencePool<uint64_t> pool(
+		inFlight, InferencePool<uint64_t>::Scheduling::ROUND_ROBIN,
+		[&detector, &device, &input, &hostWork](const std::size_t&, uint64_t&) {
+			hostWork();
+			{
+				std::lock_guard<std::mutex> lock(device);
+				benchmark::DoNotOptimize(detector.Infer(input).size());
+			}
+		},
+		[](uint64_t&) {});
+
+	uint64_t frame = 0;
+	for (auto _ : state)
+	{
+		pool.WaitForWorker();
+		pool.Submit(uint64_t(frame++));
+	}
+	pool.Stop();
+
+	state.counters["inFlight"] = static_cast<double>(inFlight);
+	state.SetItemsProcessed(static_cast<int64_t>(frame));
+}
+BENCHMARK(BM_FramesInFlight)->Arg(1)->Arg(2)->Arg(3)->ArgName("inFlight")->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
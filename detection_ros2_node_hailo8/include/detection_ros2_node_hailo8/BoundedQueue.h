@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Thread-safe bounded queue used to hand work between pipeline stages.
+ *
+ * When the queue is full the oldest element is dropped, so a capacity of one
+ * gives latest-frame-wins semantics. The elements live in a ring allocated
+ * once, pushing and popping moves them in and out without heap allocation.
+ * A dropped element can be taken back by the caller to reuse its buffers.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(const std::size_t& capacity = 1) :
+		m_items(capacity > 0 ? capacity : 1),
+		m_head(0),
+		m_size(0),
+		m_mutex(),
+		m_cv(),
+		m_stopped(false),
+		m_dropped(0)
+	{
+	}
+
+	/**
+	 * @brief Push an item, replacing the oldest one if the queue is full.
+	 * @return True if an older item had to be dropped
+	 */
+	bool Push(T&& item)
+	{
+		T displaced;
+		return Push(std::move(item), displaced);
+	}
+
+	/**
+	 * @brief Push an item, replacing the oldest one if the queue is full.
+	 * @param displaced Receives the dropped item, unchanged if none was dropped
+	 * @return True if an older item had to be dropped
+	 */
+	bool Push(T&& item, T& displaced)
+	{
+		bool dropped = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopped) return false;
+
+			if (m_size == m_items.size())
+			{
+				displaced = std::move(m_items[m_head]);
+				m_head    = (m_head + 1) % m_items.size();
+				m_size--;
+				dropped = true;
+				m_dropped++;
+			}
+
+			m_items[(m_head + m_size++) % m_items.size()] = std::move(item);
+		}
+
+		m_cv.notify_one();
+		return dropped;
+	}
+
+	/**
+	 * @brief Push an item only if the queue is not full, nothing is dropped.
+	 * @return True if the item has been added
+	 */
+	bool TryPush(T&& item)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopped || m_size == m_items.size()) return false;
+
+			m_items[(m_head + m_size++) % m_items.size()] = std::move(item);
+		}
+
+		m_cv.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief Block until an item is available or the queue is stopped.
+	 * @return False if the queue has been stopped
+	 */
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this] { return m_stopped || m_size > 0; });
+
+		if (m_stopped) return false;
+
+		item   = std::move(m_items[m_head]);
+		m_head = (m_head + 1) % m_items.size();
+		m_size--;
+		return true;
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopped = true;
+			for (; m_size > 0; m_size--, m_head = (m_head + 1) % m_items.size())
+				m_items[m_head] = T();
+		}
+		m_cv.notify_all();
+	}
+
+	std::size_t Size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_size;
+	}
+
+	uint64_t GetDroppedCount() const
+	{
+		return m_dropped.load();
+	}
+
+private:
+	std::vector<T> m_items; // Ring of capacity elements
+	std::size_t m_head;     // Oldest element
+	std::size_t m_size;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stopped;
+	std::atomic<uint64_t> m_dropped;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Free list of per-frame buffers handed between pipeline stages.
+ *
+ * A stage acquires a buffer for a frame, the last stage touching the frame
+ * releases it once the frame is published. Buffers keep their capacity while
+ * they are in the pool, so in steady state every frame reuses the buffers of
+ * an earlier one and no heap allocation happens. The pool grows to the number
+ * of frames in flight and stays there.
+ */
+template<typename T>
+class BufferPool
+{
+public:
+	/**
+	 * @param reserve Expected number of buffers in flight, avoids growing the free list
+	 */
+	explicit BufferPool(const std::size_t& reserve = 0) :
+		m_free(),
+		m_mutex()
+	{
+		m_free.reserve(reserve);
+	}
+
+	BufferPool(const BufferPool&)            = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	/**
+	 * @brief Take a released buffer, or a new one if none is available.
+	 * The content of a reused buffer is left as released, the caller resets what it needs.
+	 */
+	T Acquire()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_free.empty()) return T();
+
+		T item = std::move(m_free.back());
+		m_free.pop_back();
+		return item;
+	}
+
+	/**
+	 * @brief Return a buffer for reuse by a later frame.
+	 */
+	void Release(T&& item)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_free.push_back(std::move(item));
+	}
+
+	std::size_t Size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_free.size();
+	}
+
+private:
+	std::vector<T> m_free;
+	mutable std::mutex m_mutex;
+};
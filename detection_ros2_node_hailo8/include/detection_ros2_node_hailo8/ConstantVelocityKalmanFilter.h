@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Constant velocity Kalman filter for SORT with compile-time dimensions.
+ *
+ * State is [cx, cy, s, r, vcx, vcy, vs], the measurement is [cx, cy, s, r].
+ * Replaces a generic cv::KalmanFilter(7, 4, 0) with the same noise setup:
+ * The transition matrix only adds the velocities to the first three state
+ * entries and the measurement matrix is the identity on the first four, so
+ * both are applied implicitly. The 4x4 innovation covariance is inverted in
+ * closed form. All state is stored inline, nothing is allocated.
+ */
+class ConstantVelocityKalmanFilter
+{
+public:
+	static constexpr uint32_t DIM_X = 7;
+	static constexpr uint32_t DIM_Z = 4;
+
+	using State       = std::array<float, DIM_X>;
+	using Measurement = std::array<float, DIM_Z>;
+
+	static constexpr float PROCESS_NOISE     = 1e-2f;
+	static constexpr float MEASUREMENT_NOISE = 1e-1f;
+	static constexpr float INITIAL_COV       = 1.0f;
+
+public:
+	ConstantVelocityKalmanFilter() :
+		m_x(),
+		m_P()
+	{
+		Init(Measurement());
+	}
+
+	/**
+	 * @brief Reset the filter to the given measurement with zero velocity.
+	 */
+	void Init(const Measurement& z)
+	{
+		m_x.fill(0.0f);
+		for (uint32_t i = 0; i < DIM_Z; i++)
+			m_x[i] = z[i];
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+			for (uint32_t j = 0; j < DIM_X; j++)
+				m_P[i][j] = (i == j) ? INITIAL_COV : 0.0f;
+	}
+
+	/**
+	 * @brief x = F * x, P = F * P * F^T + Q
+	 */
+	const State& Predict()
+	{
+		m_x[0] += m_x[4];
+		m_x[1] += m_x[5];
+		m_x[2] += m_x[6];
+
+		// F * P: add rows 4..6 to rows 0..2
+		for (uint32_t i = 0; i < 3; i++)
+			for (uint32_t j = 0; j < DIM_X; j++)
+				m_P[i][j] += m_P[i + 4][j];
+
+		// (F * P) * F^T: add columns 4..6 to columns 0..2
+		for (uint32_t i = 0; i < DIM_X; i++)
+			for (uint32_t j = 0; j < 3; j++)
+				m_P[i][j] += m_P[i][j + 4];
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+			m_P[i][i] += PROCESS_NOISE;
+
+		return m_x;
+	}
+
+	/**
+	 * @brief Correct the state with the given measurement.
+	 */
+	const State& Correct(const Measurement& z)
+	{
+		// S = H * P * H^T + R is the upper left 4x4 block of P plus R
+		float S[DIM_Z][DIM_Z];
+		for (uint32_t i = 0; i < DIM_Z; i++)
+			for (uint32_t j = 0; j < DIM_Z; j++)
+				S[i][j] = m_P[i][j] + ((i == j) ? MEASUREMENT_NOISE : 0.0f);
+
+		float Si[DIM_Z][DIM_Z];
+		if (!Invert4x4(S, Si))
+			return m_x;
+
+		// P * H^T are the first four columns of P, keep a copy for the covariance update
+		float PHt[DIM_X][DIM_Z];
+		for (uint32_t i = 0; i < DIM_X; i++)
+			for (uint32_t j = 0; j < DIM_Z; j++)
+				PHt[i][j] = m_P[i][j];
+
+		// K = P * H^T * S^-1
+		float K[DIM_X][DIM_Z];
+		for (uint32_t i = 0; i < DIM_X; i++)
+		{
+			for (uint32_t j = 0; j < DIM_Z; j++)
+			{
+				K[i][j] = PHt[i][0] * Si[0][j] + PHt[i][1] * Si[1][j] + PHt[i][2] * Si[2][j] + PHt[i][3] * Si[3][j];
+			}
+		}
+
+		// x = x + K * (z - H * x)
+		float y[DIM_Z];
+		for (uint32_t i = 0; i < DIM_Z; i++)
+			y[i] = z[i] - m_x[i];
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+			m_x[i] += K[i][0] * y[0] + K[i][1] * y[1] + K[i][2] * y[2] + K[i][3] * y[3];
+
+		// P = P - K * H * P, where (H * P)[k][j] = P[k][j] = PHt[j][k] due to symmetry
+		for (uint32_t i = 0; i < DIM_X; i++)
+		{
+			for (uint32_t j = 0; j < DIM_X; j++)
+			{
+				m_P[i][j] -= K[i][0] * PHt[j][0] + K[i][1] * PHt[j][1] + K[i][2] * PHt[j][2] + K[i][3] * PHt[j][3];
+			}
+		}
+
+		return m_x;
+	}
+
+	const State& GetState() const
+	{
+		return m_x;
+	}
+
+	const float& GetCovariance(const uint32_t& row, const uint32_t& col) const
+	{
+		return m_P[row][col];
+	}
+
+	// Closed-form inverse of a 4x4 matrix via 2x2 sub-determinants
+	static bool Invert4x4(const float m[DIM_Z][DIM_Z], float inv[DIM_Z][DIM_Z])
+	{
+		const float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		const float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		const float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		const float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		const float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		const float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+		const float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		const float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		const float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		const float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		const float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		const float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+		const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		if (det == 0.0f)
+			return false;
+
+		const float invDet = 1.0f / det;
+
+		inv[0][0] = (m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * invDet;
+		inv[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * invDet;
+		inv[0][2] = (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * invDet;
+		inv[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * invDet;
+
+		inv[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * invDet;
+		inv[1][1] = (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * invDet;
+		inv[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * invDet;
+		inv[1][3] = (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * invDet;
+
+		inv[2][0] = (m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * invDet;
+		inv[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * invDet;
+		inv[2][2] = (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * invDet;
+		inv[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * invDet;
+
+		inv[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * invDet;
+		inv[3][1] = (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * invDet;
+		inv[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * invDet;
+		inv[3][3] = (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * invDet;
+
+		return true;
+	}
+
+private:
+	State m_x;
+	float m_P[DIM_X][DIM_X];
+};
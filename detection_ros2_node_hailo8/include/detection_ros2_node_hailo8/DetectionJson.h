@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+/**
+ * @brief Convert a top left based box into a center based box.
+ */
+inline BBox ToCenter(const BBox& bBox)
+{
+	// x_y = center
+	float h = bBox.height;
+	float w = bBox.width;
+	float x = bBox.x + (w / 2);
+	float y = bBox.y + (h / 2);
+	return BBox(x, y, w, h);
+}
+
+/**
+ * @brief Minimal JSON writer appending to a string buffer.
+ *
+ * Numbers are formatted with std::to_chars, which is locale independent and
+ * does not allocate. Once the buffer has grown to the usual message size,
+ * writing does not allocate at all.
+ */
+class JsonWriter
+{
+	static constexpr std::size_t NUM_BUF_SIZE = 32;
+
+public:
+	explicit JsonWriter(std::string& out) :
+		m_out(out)
+	{
+	}
+
+	JsonWriter& Raw(const char* str, const std::size_t& len)
+	{
+		m_out.append(str, len);
+		return *this;
+	}
+
+	template<std::size_t N>
+	JsonWriter& Raw(const char (&str)[N])
+	{
+		return Raw(str, N - 1);
+	}
+
+	JsonWriter& Raw(const std::string& str)
+	{
+		return Raw(str.data(), str.size());
+	}
+
+	// Writes "str", the content is not escaped
+	JsonWriter& String(const std::string& str)
+	{
+		m_out.push_back('"');
+		m_out.append(str);
+		m_out.push_back('"');
+		return *this;
+	}
+
+	JsonWriter& UInt(const uint64_t& value)
+	{
+		char buf[NUM_BUF_SIZE];
+		const std::to_chars_result res = std::to_chars(buf, buf + NUM_BUF_SIZE, value);
+		return Raw(buf, static_cast<std::size_t>(res.ptr - buf));
+	}
+
+	/**
+	 * @brief Writes the value rounded to three decimals, same output as printf("%.3f", roundf(value * 1000) / 1000).
+	 * The rounded value is written as an integer number of thousandths, which is exact and fast.
+	 */
+	JsonWriter& Fixed3(const float& value)
+	{
+		const float milli   = std::round(value * 1000.0f);
+		const uint64_t abs  = static_cast<uint64_t>(std::fabs(milli));
+		const uint64_t frac = abs % 1000;
+
+		if (std::signbit(milli)) m_out.push_back('-');
+		UInt(abs / 1000);
+
+		const char digits[4] = { '.', static_cast<char>('0' + frac / 100), static_cast<char>('0' + (frac / 10) % 10), static_cast<char>('0' + frac % 10) };
+		return Raw(digits, 4);
+	}
+
+	/**
+	 * @brief Writes the value with two decimals, same output as printf("%.2f", value).
+	 */
+	JsonWriter& Fixed2(const double& value)
+	{
+		char buf[NUM_BUF_SIZE];
+#if defined(__cpp_lib_to_chars)
+		const std::to_chars_result res = std::to_chars(buf, buf + NUM_BUF_SIZE, value, std::chars_format::fixed, 2);
+		return Raw(buf, static_cast<std::size_t>(res.ptr - buf));
+#else
+		// Floating point std::to_chars is not available before GCC 11
+		const int len = std::snprintf(buf, NUM_BUF_SIZE, "%.2f", value);
+		return Raw(buf, static_cast<std::size_t>(len > 0 ? std::min(len, static_cast<int>(NUM_BUF_SIZE) - 1) : 0));
+#endif
+	}
+
+private:
+	std::string& m_out;
+};
+
+/**
+ * @brief Upper bound of the JSON size for the given number of tracks, names without characters to escape.
+ * A buffer reserved for it is not grown by WriteDetectionJson.
+ */
+inline std::size_t DetectionJsonCapacity(const std::string& detectStr, const std::string& amountStr, const std::size_t& tracks, const std::vector<std::string>& classNames)
+{
+	// Object entry without the name, with a 10 digit track ID and the separator
+	constexpr std::size_t BYTES_PER_OBJECT = 96;
+
+	std::size_t longestName = 7; // "Unknown"
+	for (const std::string& name : classNames)
+		longestName = std::max(longestName, name.size());
+
+	return 64 + detectStr.size() + amountStr.size() + tracks * (BYTES_PER_OBJECT + longestName);
+}
+
+/**
+ * @brief Write the JSON string published on the detection topic.
+ * The schema is the one documented in the README.
+ * @param out Buffer to write to, its content is replaced but its capacity is reused
+ * @param detectStr Key of the detection list
+ * @param amountStr Key of the detection count
+ * @param trackers Tracked objects to serialize
+ * @param classNames Class file entries, the names of the objects are looked up by class ID
+ */
+inline void WriteDetectionJson(std::string& out, const std::string& detectStr, const std::string& amountStr, const TrackingObjects& trackers, const std::vector<std::string>& classNames)
+{
+	// Typical size of one object entry, avoids growing the buffer step by step
+	constexpr std::size_t BYTES_PER_OBJECT = 96;
+
+	out.clear();
+	out.reserve(64 + detectStr.size() + amountStr.size() + trackers.size() * BYTES_PER_OBJECT);
+
+	JsonWriter json(out);
+	json.Raw("{").String(detectStr).Raw(": [");
+
+	for (std::size_t i = 0; i < trackers.size(); i++)
+	{
+		const TrackingObject& t = trackers[i];
+		const BBox centerBox    = ToCenter(t.bBox);
+
+		json.Raw("{\"TrackID\": ").UInt(t.trackingID);
+		json.Raw(", \"name\": ").String(GetClassName(classNames, t.classID));
+		json.Raw(", \"center\": [").Fixed3(centerBox.x).Raw(",").Fixed3(centerBox.y);
+		json.Raw("], \"w_h\": [").Fixed3(centerBox.width).Raw(",").Fixed3(centerBox.height).Raw("]}");
+
+		// Prevent a trailing ',' for the last element
+		if (i + 1 < trackers.size()) json.Raw(", ");
+	}
+
+	json.Raw("], ").String(amountStr).Raw(": ").UInt(trackers.size()).Raw(" }");
+}
+
+/**
+ * @brief Values published on the FPS topic.
+ */
+struct FpsStats
+{
+	float fps              = 0.0f;
+	float itrTime          = 0.0f; // Duration of the last iteration in ms
+	double maxFPS          = 0.0;
+	uint64_t droppedFrames = 0;
+	uint64_t skippedFrames = 0;
+	uint64_t staleFrames   = 0;
+	double queueAgeMSec    = 0.0;
+	std::size_t amount     = 0;
+
+	// Motion gating, only written if enabled
+	bool motionGating       = false;
+	float motionSensitivity = 0.0f;
+	float motionSkipRatio   = 0.0f; // Fraction of the frames skipped since the last report
+	double motionSavedMSec  = 0.0;  // Estimated inference time saved since the last report
+
+	// Tiled inference, only written if enabled
+	std::string tiling;     // Tile layout, e.g. "2x2+full"
+	uint32_t tiles   = 0;   // Network inputs per frame
+	double inferMSec = 0.0; // Smoothed preprocessing and inference time of one frame
+
+	// Several input streams, only written if there are more than one
+	uint32_t streams = 0;
+	float batchSize  = 0.0f; // Average frames per inference call since the last report
+
+	// Several devices, only written if there are more than one
+	std::vector<float> deviceUtilization; // Busy fraction of every device since the last report
+};
+
+/**
+ * @brief Write the JSON string published on the FPS topic.
+ * @param out Buffer to write to, its content is replaced but its capacity is reused
+ */
+inline void WriteFpsJson(std::string& out, const std::string& fpsStr, const std::string& amountStr, const FpsStats& stats)
+{
+	out.clear();
+	JsonWriter json(out);
+
+	if (stats.fps == 0.0f)
+	{
+		json.Raw("{").String(fpsStr).Raw(": 0.0}");
+		return;
+	}
+
+	json.Raw("{").String(fpsStr).Raw(": ").Fixed2(stats.fps);
+	json.Raw(", \"lastCurrMSec\": ").Fixed2(stats.itrTime);
+	json.Raw(", \"maxFPS\": ").Fixed2(stats.maxFPS);
+	json.Raw(", \"droppedFrames\": ").UInt(stats.droppedFrames);
+	json.Raw(", \"skippedFrames\": ").UInt(stats.skippedFrames);
+	json.Raw(", \"staleFrames\": ").UInt(stats.staleFrames);
+	json.Raw(", \"queueAgeMSec\": ").Fixed2(stats.queueAgeMSec);
+
+	if (stats.motionGating)
+	{
+		json.Raw(", \"motionSensitivity\": ").Fixed2(stats.motionSensitivity);
+		json.Raw(", \"motionSkipRatio\": ").Fixed2(stats.motionSkipRatio);
+		json.Raw(", \"motionSavedMSec\": ").Fixed2(stats.motionSavedMSec);
+	}
+
+	if (!stats.tiling.empty())
+	{
+		json.Raw(", \"tiling\": ").String(stats.tiling);
+		json.Raw(", \"tilesPerSec\": ").Fixed2(stats.fps * static_cast<float>(stats.tiles));
+		json.Raw(", \"inferMSec\": ").Fixed2(stats.inferMSec);
+	}
+
+	if (stats.streams > 1)
+	{
+		json.Raw(", \"streams\": ").UInt(stats.streams);
+		json.Raw(", \"batchSize\": ").Fixed2(stats.batchSize);
+	}
+
+	if (stats.deviceUtilization.size() > 1)
+	{
+		json.Raw(", \"deviceUtilization\": [");
+		for (std::size_t i = 0; i < stats.deviceUtilization.size(); i++)
+		{
+			if (i > 0) json.Raw(", ");
+			json.Fixed2(stats.deviceUtilization[i]);
+		}
+		json.Raw("]");
+	}
+
+	json.Raw(", ").String(amountStr).Raw(": ").UInt(stats.amount).Raw(" }");
+}
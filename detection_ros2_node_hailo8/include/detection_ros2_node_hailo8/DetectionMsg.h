@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+
+#include <std_msgs/msg/header.hpp>
+
+#include "detection_interfaces/msg/detection_array.hpp"
+#include "detection_interfaces/msg/detection_delta.hpp"
+
+#include "TrackDelta.h"
+#include "Types.h"
+
+/**
+ * @brief Fill one detection of a typed message.
+ * @param d Detection to fill
+ * @param t Tracked object with box normalized to [0, 1]
+ * @param w Width of the source image in pixels
+ * @param h Height of the source image in pixels
+ */
+inline void FillDetection(detection_interfaces::msg::Detection& d, const TrackingObject& t, const float& w, const float& h)
+{
+	d.track_id   = t.trackingID;
+	d.class_id   = t.classID;
+	d.score      = static_cast<float>(t.score) / 100.0f;
+	d.box        = { t.bBox.x, t.bBox.y, t.bBox.width, t.bBox.height };
+	d.box_pixels = { t.bBox.x * w, t.bBox.y * h, t.bBox.width * w, t.bBox.height * h };
+}
+
+/**
+ * @brief Reserve the detections of a reused array message for the given number of tracks.
+ */
+inline void ReserveDetectionArray(detection_interfaces::msg::DetectionArray& msg, const std::size_t& tracks)
+{
+	msg.detections.reserve(tracks);
+}
+
+/**
+ * @brief Reserve the lists of a reused delta message for the given number of tracks.
+ */
+inline void ReserveDetectionDelta(detection_interfaces::msg::DetectionDelta& msg, const std::size_t& tracks)
+{
+	msg.added.reserve(tracks);
+	msg.updated.reserve(tracks);
+	msg.removed.reserve(tracks);
+}
+
+/**
+ * @brief Fill the typed detection message published on the detection array topic.
+ * @param msg Message to fill, existing detections are replaced
+ * @param header Header of the source image
+ * @param width Width of the source image in pixels
+ * @param height Height of the source image in pixels
+ * @param trackers Tracked objects with boxes normalized to [0, 1]
+ */
+inline void FillDetectionArray(detection_interfaces::msg::DetectionArray& msg, const std_msgs::msg::Header& header, const uint32_t& width, const uint32_t& height,
+							   const TrackingObjects& trackers)
+{
+	msg.header       = header;
+	msg.image_width  = width;
+	msg.image_height = height;
+
+	const float w = static_cast<float>(width);
+	const float h = static_cast<float>(height);
+
+	msg.detections.resize(trackers.size());
+	for (std::size_t i = 0; i < trackers.size(); i++)
+		FillDetection(msg.detections[i], trackers[i], w, h);
+}
+
+/**
+ * @brief Fill the delta message published on the detection delta topic.
+ * A keyframe carries all tracks as added and no updates or removals.
+ * @param msg Message to fill, existing content is replaced
+ * @param header Header of the source image
+ * @param width Width of the source image in pixels
+ * @param height Height of the source image in pixels
+ * @param trackers Tracked objects with boxes normalized to [0, 1]
+ * @param events Changes of this frame, the indices refer to trackers
+ */
+inline void FillDetectionDelta(detection_interfaces::msg::DetectionDelta& msg, const std_msgs::msg::Header& header, const uint32_t& width, const uint32_t& height,
+							   const TrackingObjects& trackers, const TrackDelta::Events& events)
+{
+	msg.header       = header;
+	msg.image_width  = width;
+	msg.image_height = height;
+	msg.keyframe     = events.keyframe;
+
+	const float w = static_cast<float>(width);
+	const float h = static_cast<float>(height);
+
+	if (events.keyframe)
+	{
+		msg.added.resize(trackers.size());
+		for (std::size_t i = 0; i < trackers.size(); i++)
+			FillDetection(msg.added[i], trackers[i], w, h);
+
+		msg.updated.clear();
+		msg.removed.clear();
+		return;
+	}
+
+	msg.added.resize(events.added.size());
+	for (std::size_t i = 0; i < events.added.size(); i++)
+		FillDetection(msg.added[i], trackers[events.added[i]], w, h);
+
+	msg.updated.resize(events.updated.size());
+	for (std::size_t i = 0; i < events.updated.size(); i++)
+		FillDetection(msg.updated[i], trackers[events.updated[i]], w, h);
+
+	msg.removed.assign(events.removed.begin(), events.removed.end());
+}
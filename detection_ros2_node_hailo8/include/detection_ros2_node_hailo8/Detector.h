@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Single detection returned by a detector, box normalized to [0, 1] with top left origin.
+ * The class name is looked up in Detector::GetClassNames only when needed.
+ */
+struct Detection
+{
+	uint32_t classID; // 1-based class index into the class file
+	float x;
+	float y;
+	float w;
+	float h;
+	float classProb;
+	uint32_t tile = 0; // Network input of the frame the detection comes from, set for tiled inference
+};
+
+using Detections = std::vector<Detection>;
+
+/**
+ * @brief Read the class names of a class file, one per line, as the labels of YoloHailo.
+ * Empty lines keep their position so the 1-based class ID of a detection indexes this list,
+ * a trailing '\r' of files with CRLF line endings is removed.
+ */
+inline std::vector<std::string> LoadClassNames(const std::string &classFile)
+{
+	std::vector<std::string> names;
+	std::ifstream file(classFile);
+	std::string line;
+
+	while (file.good() && std::getline(file, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		names.push_back(line);
+	}
+
+	return names;
+}
+
+/**
+ * @brief Interface of an inference backend used by the detection node.
+ *
+ * The inference calls are blocking and cover the whole inference of their inputs.
+ * The node serializes them per device, several workers of a device only overlap
+ * the work around the call (preprocessing, box mapping, tile merging).
+ * There is no separate submit/complete: for the Hailo8 backend the call includes
+ * the input transfer, the wait for the device, the output transfer and the YOLO
+ * decode on the host, YoloHailo offers no finer interface.
+ */
+class Detector
+{
+public:
+	virtual ~Detector() = default;
+
+	/**
+	 * @brief Run the network on the given frame.
+	 * @param img Input frame (BGR)
+	 * @return Detections of the frame
+	 */
+	virtual Detections Infer(cv::Mat &img) = 0;
+
+	/**
+	 * @brief Run the network on the given frame, writing into a reused result buffer.
+	 * Backends override it to fill the buffer in place, without allocation once it has grown.
+	 * @param img Input frame (BGR)
+	 * @param dets Detections of the frame, existing entries are replaced
+	 */
+	virtual void InferInto(cv::Mat &img, Detections &dets)
+	{
+		dets = Infer(img);
+	}
+
+	/**
+	 * @brief Run the network on several frames of the same size, e.g. the tiles of one frame.
+	 * Runs them back-to-back by default, backends with batch support can override it.
+	 * @param imgs Input frames (BGR)
+	 * @param results Detections of every frame, resized to the number of frames
+	 */
+	virtual void InferBatch(std::vector<cv::Mat> &imgs, std::vector<Detections> &results)
+	{
+		results.resize(imgs.size());
+		for (std::size_t i = 0; i < imgs.size(); i++)
+			InferInto(imgs[i], results[i]);
+	}
+
+	/**
+	 * @brief Names of the classes, indexed by the class ID minus one.
+	 */
+	virtual const std::vector<std::string> &GetClassNames() const = 0;
+
+	std::size_t GetClassCount() const
+	{
+		return GetClassNames().size();
+	}
+
+	virtual void StartPowerMeasuring()
+	{
+	}
+
+	virtual float GetAveragePower()
+	{
+		return 0.0f;
+	}
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Latest-frame-wins slots of several input streams, drained in batches.
+ *
+ * Every stream has a slot of capacity one, a newer frame replaces the pending
+ * one of the same stream. A batch holds at most one frame per stream, so a
+ * fast stream can never occupy more than its share of a batch. If the batch
+ * size is limited below the number of streams, the stream the batch starts
+ * with rotates round-robin, so every stream is served within a few batches.
+ *
+ * After the first frame is available, PopBatch waits up to the batch window
+ * for the other streams, frames arriving within the window share one
+ * inference call.
+ */
+template<typename T>
+class FrameBatcher
+{
+public:
+	/**
+	 * @param streams Number of input streams
+	 * @param maxBatch Maximum number of frames per batch, 0 allows one frame of every stream
+	 */
+	explicit FrameBatcher(const std::size_t& streams = 1, const std::size_t& maxBatch = 0) :
+		m_slots(std::max<std::size_t>(streams, 1)),
+		m_maxBatch((maxBatch == 0 || maxBatch > m_slots.size()) ? m_slots.size() : maxBatch),
+		m_next(0),
+		m_pending(0),
+		m_mutex(),
+		m_cv(),
+		m_stopped(false),
+		m_dropped(0)
+	{
+	}
+
+	std::size_t GetStreamCount() const
+	{
+		return m_slots.size();
+	}
+
+	/**
+	 * @brief Push a frame of the given stream, replacing its pending frame.
+	 * @return True if an older frame of the stream had to be dropped
+	 */
+	bool Push(const std::size_t& stream, T&& item)
+	{
+		bool dropped = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopped) return false;
+
+			std::optional<T>& slot = m_slots[stream];
+			if (slot)
+			{
+				dropped = true;
+				m_dropped++;
+			}
+			else
+				m_pending++;
+
+			slot = std::move(item);
+		}
+
+		m_cv.notify_one();
+		return dropped;
+	}
+
+	/**
+	 * @brief Block until a frame is available, then collect the frames arriving within the window.
+	 * @param batch Output, pairs of stream index and frame, in round-robin order of the streams
+	 * @param window Time to wait for the other streams after the first frame
+	 * @return False if the batcher has been stopped
+	 */
+	bool PopBatch(std::vector<std::pair<std::size_t, T>>& batch, const std::chrono::microseconds& window)
+	{
+		batch.clear();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this] { return m_stopped || m_pending > 0; });
+
+		if (m_stopped) return false;
+
+		if (window.count() > 0 && m_pending < m_maxBatch)
+		{
+			m_cv.wait_for(lock, window, [this] { return m_stopped || m_pending >= m_maxBatch; });
+			if (m_stopped) return false;
+		}
+
+		const std::size_t n = m_slots.size();
+		for (std::size_t k = 0; k < n && batch.size() < m_maxBatch; k++)
+		{
+			const std::size_t stream = (m_next + k) % n;
+			std::optional<T>& slot   = m_slots[stream];
+			if (!slot) continue;
+
+			batch.emplace_back(stream, std::move(*slot));
+			slot.reset();
+			m_pending--;
+		}
+
+		// The next batch starts after the last served stream
+		m_next = (batch.back().first + 1) % n;
+		return true;
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopped = true;
+			for (std::optional<T>& slot : m_slots)
+				slot.reset();
+			m_pending = 0;
+		}
+		m_cv.notify_all();
+	}
+
+	uint64_t GetDroppedCount() const
+	{
+		return m_dropped.load();
+	}
+
+private:
+	std::vector<std::optional<T>> m_slots;
+	std::size_t m_maxBatch;
+	std::size_t m_next;    // Stream the next batch starts with
+	std::size_t m_pending; // Number of occupied slots
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stopped;
+	std::atomic<uint64_t> m_dropped;
+};
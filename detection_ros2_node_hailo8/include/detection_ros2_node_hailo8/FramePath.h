@@ -0,0 +1,605 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <std_msgs/msg/header.hpp>
+
+#include "BoundedQueue.h"
+#include "BufferPool.h"
+#include "DetectionJson.h"
+#include "DetectionMsg.h"
+#include "Detector.h"
+#include "LatencyHistogram.h"
+#include "NonMaxSuppression.h"
+#include "ParallelRunner.h"
+#include "Preprocessor.h"
+#include "SORT.h"
+#include "TileLayout.h"
+#include "TrackDelta.h"
+#include "Types.h"
+
+// Frame path of DetectionNodeHailo8 without the ROS node: inference of the batches, hand-over to the
+// tracking stage, tracking and the fill of the outgoing messages. Receiving, admission and publishing
+// stay in the node. The allocation test runs the same code.
+
+/**
+ * @brief Pipeline stages with their own latency histogram.
+ */
+enum PipelineStage : std::size_t
+{
+	STAGE_RECEIVE,    // Image header stamp to subscription callback (transport)
+	STAGE_QUEUE,      // Subscription callback to start of inference
+	STAGE_PREPROCESS, // Fused conversion, rotation and resize
+	STAGE_INFER,      // Detector inference of one model, all tiles of the frame
+	STAGE_MERGE,      // Cross-tile suppression of the detections of one model
+	STAGE_GROUP,      // Conversion of the detections for the tracker
+	STAGE_TRACK,      // SORT::Update
+	STAGE_SERIALIZE,  // Filling the typed messages and the JSON strings
+	STAGE_PUBLISH,    // Publisher calls
+	STAGE_COUNT
+};
+
+using StageLatencies = std::array<LatencyHistogram, STAGE_COUNT>;
+
+/**
+ * @brief One hosted model, shared by all input streams.
+ */
+struct NetworkContext
+{
+	/**
+	 * @brief Device stage of the model on one accelerator, shared by the batches in flight on it.
+	 */
+	struct DeviceStage
+	{
+		std::mutex mutex;                  // One batch at a time on the device
+		std::atomic<double> busyMSec{0.0}; // Time spent in the device stage
+		double busyReportedMSec = 0.0;     // Busy time at the last FPS report
+	};
+
+	std::string name;
+	int imageSize = 640;                               // Input geometry, models with the same size share the preprocessed frame
+	std::vector<std::string> devices;                  // Accelerators the model is loaded on
+	std::vector<std::unique_ptr<Detector>> detectors;  // Inference backend (Hailo8 or mock) per device
+	std::vector<std::unique_ptr<DeviceStage>> stages;  // Per device, serializes the inference calls of the workers sharing it
+	std::vector<std::string> classNames;               // Class file entries, resolved from the class IDs only for the JSON output
+	std::size_t detectionCapacity = 0;                 // Detections per frame the buffers of the frame path are reserved for
+};
+
+using Networks = std::vector<std::unique_ptr<NetworkContext>>;
+
+/**
+ * @brief Source image information passed along with the detections.
+ */
+struct FrameInfo
+{
+	std_msgs::msg::Header header;
+	uint32_t width  = 0;
+	uint32_t height = 0;
+};
+
+/**
+ * @brief Inference results handed to the tracking / publishing stage.
+ */
+struct DetectionJob
+{
+	std::size_t stream = 0;          // Input stream of the frame
+	std::vector<Detections> results; // One result set per model
+	FrameInfo frame;
+	std::chrono::high_resolution_clock::time_point received;
+	bool predicted = false;          // Frame skipped by the rate limit, the tracks are only extrapolated
+};
+
+/**
+ * @brief Frame admitted to the current inference batch.
+ */
+struct BatchItem
+{
+	sensor_msgs::msg::Image::ConstSharedPtr msg;
+	Preprocessor::Encoding encoding;
+	DetectionJob job;
+};
+
+using InferenceBatch = std::vector<BatchItem>;
+
+/**
+ * @brief Inference of the batches on the workers and hand-over of the results to the tracking stage.
+ *
+ * Every worker holds the buffers of one batch in flight and runs all models on the devices of
+ * one index. The result sets and the batch vectors circulate through free lists, the queue to
+ * the tracking stage is a preallocated ring, so no buffer is allocated per frame in steady state.
+ */
+class InferenceStage
+{
+	using hires_clock = std::chrono::high_resolution_clock;
+
+	/**
+	 * @brief Buffers of one inference worker for one input stream.
+	 */
+	struct StreamBuffers
+	{
+		std::map<int, std::vector<Preprocessor>> preprocessors; // Per distinct model input size one per tile, reused for every frame
+		std::vector<Preprocessor::Region> tiles;                // Tiles of the current frame, empty if preprocessing failed
+		std::vector<NonMaxSuppression> nms;                     // Merges the detections of overlapping tiles, one per model
+	};
+
+	/**
+	 * @brief Buffer set of one batch in flight, the worker runs all models on the devices of one index.
+	 * Several workers share a device, so one batch is preprocessed and post-processed while the device infers another.
+	 */
+	struct InferenceWorker
+	{
+		std::size_t device = 0;                       // Index into the devices of every model
+		std::string devices;                          // Device IDs of the models, for the statistics
+		std::vector<std::vector<cv::Mat>> inputs;     // Per model the network inputs of the current batch, all tiles of all batched frames
+		std::vector<std::vector<Detections>> outputs; // Per model the detections per input, kept to avoid reallocation
+		std::vector<StreamBuffers> streams;           // One per input stream
+		std::unique_ptr<ParallelRunner> models;       // Runs the models of a batch concurrently, started once with the worker
+	};
+
+public:
+	/**
+	 * @param networks Hosted models, all with the same number of devices, kept by the caller
+	 * @param streams Number of input streams
+	 * @param framesInFlight Workers per device
+	 * @param tileLayout Tiles every frame is split into
+	 * @param letterbox Keep the aspect ratio, otherwise frames are stretched to the input size
+	 * @param rotation Clockwise rotation of the frames in degrees
+	 * @param mergeThreshold Intersection over smaller area above which detections of different tiles are merged
+	 * @param latency Histograms of the preprocess, infer and merge stages
+	 */
+	InferenceStage(const Networks& networks, const std::size_t& streams, const std::size_t& framesInFlight, const TileLayout& tileLayout,
+				   const bool& letterbox, const uint32_t& rotation, const float& mergeThreshold, StageLatencies& latency) :
+		m_networks(networks),
+		m_tileLayout(tileLayout),
+		m_rotation(rotation),
+		m_mergeThreshold(mergeThreshold),
+		m_latency(latency),
+		m_workers(),
+		m_batchPool(),
+		m_resultsPool(),
+		m_queue(2 * streams)
+	{
+		// Consecutive workers use different devices, so round-robin scheduling alternates the devices
+		const std::size_t devices = m_networks.front()->detectors.size();
+		for (std::size_t w = 0; w < devices * std::max<std::size_t>(framesInFlight, 1); w++)
+		{
+			m_workers.push_back(std::make_unique<InferenceWorker>());
+			InferenceWorker& worker = *m_workers.back();
+
+			worker.device = w % devices;
+			worker.inputs.resize(m_networks.size());
+			worker.outputs.resize(m_networks.size());
+			worker.streams.resize(streams);
+			worker.models = std::make_unique<ParallelRunner>(m_networks.size());
+
+			for (const auto& network : m_networks)
+			{
+				worker.devices += (worker.devices.empty() ? "" : "+") + network->devices[worker.device];
+
+				// Models with the same input size share the preprocessed tiles of a stream
+				for (StreamBuffers& buffers : worker.streams)
+				{
+					if (!buffers.preprocessors.count(network->imageSize))
+						buffers.preprocessors.emplace(network->imageSize, std::vector<Preprocessor>(m_tileLayout.GetTileCount(), Preprocessor(static_cast<uint32_t>(network->imageSize), letterbox)));
+					buffers.nms.resize(m_networks.size());
+				}
+			}
+		}
+	}
+
+	InferenceStage(const InferenceStage&)            = delete;
+	InferenceStage& operator=(const InferenceStage&) = delete;
+
+	std::size_t GetWorkerCount() const
+	{
+		return m_workers.size();
+	}
+
+	InferenceBatch AcquireBatch()
+	{
+		return m_batchPool.Acquire();
+	}
+
+	void ReleaseBatch(InferenceBatch&& batch)
+	{
+		m_batchPool.Release(std::move(batch));
+	}
+
+	/**
+	 * @brief Run all models on the frames of one batch, called on the thread of an inference worker.
+	 * Every tile of every frame is converted, rotated and resized in one pass into the reused input buffers
+	 * of the worker, one per stream and distinct model input size. Each model infers the tiles of all frames
+	 * in one call on the device of the worker, the models are run concurrently on the threads of the worker. Only
+	 * this call is serialized between the workers sharing a device, so their preprocessing and post-processing overlap the inference.
+	 * The detections are mapped back to the rotated frames, the detections of overlapping tiles are merged.
+	 * @param w Index of the worker running the batch
+	 * @param batch Frames to infer, the results are stored in their jobs, predicted frames are passed through
+	 */
+	void Process(const std::size_t& w, InferenceBatch& batch)
+	{
+		InferenceWorker& worker               = *m_workers[w];
+		const hires_clock::time_point started = hires_clock::now();
+		std::size_t frames                    = 0;
+
+		{
+			ScopedLatency latency(m_latency[STAGE_PREPROCESS]);
+			for (BatchItem& item : batch)
+			{
+				StreamBuffers& buffers = worker.streams[item.job.stream];
+				buffers.tiles.clear();
+
+				if (item.job.predicted)
+					continue;
+
+				// All tiles of a model are collected before the cross-tile merge
+				item.job.results = m_resultsPool.Acquire();
+				item.job.results.resize(m_networks.size());
+				for (std::size_t i = 0; i < m_networks.size(); i++)
+				{
+					item.job.results[i].clear();
+					item.job.results[i].reserve(m_networks[i]->detectionCapacity * m_tileLayout.GetTileCount());
+				}
+
+				const sensor_msgs::msg::Image& msg = *item.msg;
+				const Preprocessor::Frame raw      = { msg.data.data(), msg.width, msg.height, msg.step, item.encoding };
+
+				m_tileLayout.Compute(item.job.frame.width, item.job.frame.height, buffers.tiles);
+				frames++;
+
+				for (auto& [size, preprocessors] : buffers.preprocessors)
+				{
+					for (std::size_t t = 0; t < buffers.tiles.size(); t++)
+					{
+						// The frame contributes no inputs and is reported without detections
+						if (!preprocessors[t].Process(raw, m_rotation, buffers.tiles[t]))
+							buffers.tiles.clear();
+					}
+				}
+			}
+		}
+
+		auto inferModel = [this, &worker, &batch](const std::size_t i) {
+			NetworkContext& network          = *m_networks[i];
+			std::vector<cv::Mat>& inputs     = worker.inputs[i];
+			std::vector<Detections>& outputs = worker.outputs[i];
+
+			// Headers only, the network reads the preprocessor buffers directly
+			inputs.clear();
+			for (const BatchItem& item : batch)
+			{
+				StreamBuffers& buffers                   = worker.streams[item.job.stream];
+				std::vector<Preprocessor>& preprocessors = buffers.preprocessors.at(network.imageSize);
+
+				for (std::size_t t = 0; t < buffers.tiles.size(); t++)
+					inputs.push_back(cv::Mat(network.imageSize, network.imageSize, CV_8UC3, preprocessors[t].GetData()));
+			}
+
+			{
+				// The other workers of the device preprocess and post-process their batches meanwhile.
+				// The lock covers the whole detector call, for Hailo8 including the YOLO decode on the host.
+				NetworkContext::DeviceStage& stage = *network.stages[worker.device];
+				std::lock_guard<std::mutex> lock(stage.mutex);
+
+				const hires_clock::time_point start = hires_clock::now();
+				{
+					ScopedLatency latency(m_latency[STAGE_INFER]);
+					network.detectors[worker.device]->InferBatch(inputs, outputs);
+				}
+				stage.busyMSec = stage.busyMSec.load() + std::chrono::duration<double, std::milli>(hires_clock::now() - start).count();
+			}
+
+			std::size_t input = 0;
+			for (BatchItem& item : batch)
+			{
+				StreamBuffers& buffers                   = worker.streams[item.job.stream];
+				std::vector<Preprocessor>& preprocessors = buffers.preprocessors.at(network.imageSize);
+
+				for (std::size_t t = 0; t < buffers.tiles.size(); t++, input++)
+				{
+					for (Detection& res : outputs[input])
+					{
+						preprocessors[t].ToFrame(res.x, res.y, res.w, res.h);
+						res.tile = static_cast<uint32_t>(t);
+						item.job.results[i].push_back(std::move(res));
+					}
+				}
+
+				if (buffers.tiles.size() > 1)
+				{
+					ScopedLatency latency(m_latency[STAGE_MERGE]);
+					buffers.nms[i].Apply(item.job.results[i], m_mergeThreshold);
+				}
+			}
+		};
+
+		worker.models->Run(inferModel);
+
+		for (BatchItem& item : batch)
+			item.msg.reset();
+
+		const double inferenceMSec = std::chrono::duration<double, std::milli>(hires_clock::now() - started).count();
+		m_inferenceMSec            = (m_inferenceMSec.load() > 0.0) ? 0.9 * m_inferenceMSec.load() + 0.1 * inferenceMSec : inferenceMSec;
+		m_batches++;
+		m_batchedFrames += frames;
+	}
+
+	/**
+	 * @brief Hand the results of a batch to the tracking stage, called in dispatch order.
+	 * Results of a frame the tracking stage has not taken yet are replaced by the newer ones, their buffers are reused.
+	 * @param batch Processed batch, released to the batch pool
+	 * @param isStale Called with every inferred job, true discards its results
+	 * @return Number of inferred frames displaced from the queue
+	 */
+	template<typename StaleFn>
+	std::size_t Deliver(InferenceBatch& batch, const StaleFn& isStale)
+	{
+		std::size_t displacedFrames = 0;
+
+		for (BatchItem& item : batch)
+		{
+			if (item.job.predicted)
+			{
+				// Never displaces inference results waiting for tracking
+				m_queue.TryPush(std::move(item.job));
+				continue;
+			}
+
+			if (isStale(item.job))
+			{
+				m_resultsPool.Release(std::move(item.job.results));
+				continue;
+			}
+
+			DetectionJob displaced;
+			if (m_queue.Push(std::move(item.job), displaced) && !displaced.predicted)
+			{
+				m_resultsPool.Release(std::move(displaced.results));
+				displacedFrames++;
+			}
+		}
+
+		// The moved-from items are dropped, the vector keeps its capacity for a later batch
+		batch.clear();
+		m_batchPool.Release(std::move(batch));
+
+		return displacedFrames;
+	}
+
+	/**
+	 * @brief Block until the tracking stage can take the next job.
+	 * @return False if the stage has been stopped
+	 */
+	bool Pop(DetectionJob& job)
+	{
+		return m_queue.Pop(job);
+	}
+
+	/**
+	 * @brief Return the result sets of a tracked job to the pool.
+	 */
+	void Release(DetectionJob& job)
+	{
+		if (!job.predicted)
+			m_resultsPool.Release(std::move(job.results));
+	}
+
+	void Stop()
+	{
+		m_queue.Stop();
+	}
+
+	std::size_t GetQueuedCount() const
+	{
+		return m_queue.Size();
+	}
+
+	uint64_t GetDroppedCount() const
+	{
+		return m_queue.GetDroppedCount();
+	}
+
+	/**
+	 * @brief Smoothed duration of Process, one batch, including the wait for the device.
+	 */
+	double GetInferenceMSec() const
+	{
+		return m_inferenceMSec.load();
+	}
+
+	uint64_t GetBatches() const
+	{
+		return m_batches.load();
+	}
+
+	uint64_t GetBatchedFrames() const
+	{
+		return m_batchedFrames.load();
+	}
+
+private:
+	const Networks& m_networks;
+	TileLayout m_tileLayout;
+	uint32_t m_rotation;
+	float m_mergeThreshold;
+	StageLatencies& m_latency;
+
+	std::vector<std::unique_ptr<InferenceWorker>> m_workers; // frames_in_flight per device
+	BufferPool<InferenceBatch> m_batchPool;                  // Batch vectors, released after delivery
+	BufferPool<std::vector<Detections>> m_resultsPool;       // Per-frame results of all models, released after tracking
+	BoundedQueue<DetectionJob> m_queue;                      // Results waiting for tracking and publishing, two per stream
+
+	std::atomic<double> m_inferenceMSec{0.0};
+	std::atomic<uint64_t> m_batches{0};       // Inference calls, to report the average batch size
+	std::atomic<uint64_t> m_batchedFrames{0}; // Frames inferred in these calls
+};
+
+/**
+ * @brief Tracks of one model on one input stream and the content of its outgoing messages.
+ *
+ * The buffers are reserved for the detection capacity of the model and twice as many tracks,
+ * as unmatched tracks live on for maxAge frames. Frames within it do not allocate.
+ */
+class ModelTracks
+{
+public:
+	/**
+	 * @param network Model producing the detections
+	 * @param crossClass Match detections to tracks of other classes
+	 * @param detectStr Key of the detections in the JSON output
+	 * @param amountStr Key of the number of detections in the JSON output
+	 * @param latency Histograms of the group and track stages
+	 */
+	ModelTracks(const NetworkContext& network, const bool& crossClass, const std::string& detectStr, const std::string& amountStr, StageLatencies& latency) :
+		m_classNames(network.classNames),
+		m_detectStr(detectStr),
+		m_amountStr(amountStr),
+		m_latency(latency),
+		m_tracker(30, 5, crossClass),
+		m_trackingDets(),
+		m_tracks(),
+		m_delta(),
+		m_trackCapacity(2 * network.detectionCapacity),
+		m_trackCount(0)
+	{
+		m_tracker.Reserve(m_trackCapacity, network.detectionCapacity);
+		m_trackingDets.reserve(network.detectionCapacity);
+		m_tracks.reserve(m_trackCapacity);
+		m_delta.Reserve(m_trackCapacity);
+	}
+
+	ModelTracks(const ModelTracks&)            = delete;
+	ModelTracks& operator=(const ModelTracks&) = delete;
+
+	/**
+	 * @brief Track the detections of an inferred frame.
+	 * @return Changes to publish, nullptr if no track appeared, vanished or moved past the hysteresis and no keyframe is due
+	 */
+	const TrackDelta::Events* Update(const Detections& results, const float& hysteresis, const uint32_t& keyframeInterval)
+	{
+		m_trackingDets.clear();
+
+		{
+			ScopedLatency latency(m_latency[STAGE_GROUP]);
+			for (const Detection& res : results)
+			{
+				float x      = res.x;
+				float y      = res.y;
+				float width  = res.w;
+				float height = res.h;
+
+				if (x < 0.0f) x = 0.0f;
+				if (y < 0.0f) y = 0.0f;
+				if (width > 1.0f) width = 1.0f;
+				if (height > 1.0f) height = 1.0f;
+
+				m_trackingDets.emplace_back(BBox(x, y, width, height), static_cast<uint32_t>(std::round(res.classProb * 100)), 0, res.classID);
+			}
+		}
+
+		{
+			ScopedLatency latency(m_latency[STAGE_TRACK]);
+			m_tracker.Update(m_trackingDets, m_tracks);
+		}
+
+		return changes(hysteresis, keyframeInterval);
+	}
+
+	/**
+	 * @brief Extrapolate the tracks to a frame that has not been inferred.
+	 * @param frames Time since the last inferred frame in inference intervals
+	 * @return Changes to publish, see Update
+	 */
+	const TrackDelta::Events* Extrapolate(const float& frames, const float& hysteresis, const uint32_t& keyframeInterval)
+	{
+		m_tracker.Extrapolate(frames, m_tracks);
+
+		return changes(hysteresis, keyframeInterval);
+	}
+
+	/**
+	 * @brief Fill the typed detection array with the current tracks.
+	 */
+	void FillArray(detection_interfaces::msg::DetectionArray& msg, const FrameInfo& frame) const
+	{
+		FillDetectionArray(msg, frame.header, frame.width, frame.height, m_tracks);
+	}
+
+	/**
+	 * @brief Fill the delta message with the changes returned by the last Update or Extrapolate.
+	 */
+	void FillDelta(detection_interfaces::msg::DetectionDelta& msg, const FrameInfo& frame, const TrackDelta::Events& events) const
+	{
+		FillDetectionDelta(msg, frame.header, frame.width, frame.height, m_tracks, events);
+	}
+
+	/**
+	 * @brief Serialize the current tracks into the JSON string, the buffer is reused.
+	 */
+	void WriteJson(std::string& out) const
+	{
+		WriteDetectionJson(out, m_detectStr, m_amountStr, m_tracks, m_classNames);
+	}
+
+	/**
+	 * @brief Tracks the reused outgoing messages should be reserved for.
+	 */
+	std::size_t GetTrackCapacity() const
+	{
+		return m_trackCapacity;
+	}
+
+	/**
+	 * @brief Size the JSON strings should be reserved for.
+	 */
+	std::size_t GetJsonCapacity() const
+	{
+		return DetectionJsonCapacity(m_detectStr, m_amountStr, m_trackCapacity, m_classNames);
+	}
+
+	/**
+	 * @brief Number of tracks last published, may be read from another thread.
+	 */
+	std::size_t GetTrackCount() const
+	{
+		return m_trackCount.load();
+	}
+
+	bool IsStatic(const float& maxSpeed) const
+	{
+		return m_tracker.IsStatic(maxSpeed);
+	}
+
+private:
+	const TrackDelta::Events* changes(const float& hysteresis, const uint32_t& keyframeInterval)
+	{
+		const TrackDelta::Events& events = m_delta.Update(m_tracks, hysteresis, keyframeInterval);
+		if (!events.keyframe && events.Empty())
+			return nullptr;
+
+		m_trackCount = m_tracks.size();
+		return &events;
+	}
+
+private:
+	const std::vector<std::string>& m_classNames; // Class file entries of the model, resolved only for the JSON output
+	const std::string m_detectStr;
+	const std::string m_amountStr;
+	StageLatencies& m_latency;
+
+	SORT m_tracker;                       // Class-aware tracker for the detections of all classes
+	TrackingObjects m_trackingDets;       // Detections of the current frame, kept to avoid reallocation
+	TrackingObjects m_tracks;             // Tracks of the current frame, kept to avoid reallocation
+	TrackDelta m_delta;                   // Changes against the last published state
+	std::size_t m_trackCapacity;          // Tracks the buffers are reserved for
+	std::atomic<std::size_t> m_trackCount; // Size of the last published tracks, read by the FPS report
+};
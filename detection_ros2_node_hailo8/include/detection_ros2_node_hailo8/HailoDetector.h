@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Detector.h"
+#include "YoloHailo.h"
+
+/**
+ * @brief Detector backend running a YOLO network on a Hailo8 accelerator.
+ * YoloHailo::Infer writes the input, waits for the device, reads and decodes the outputs
+ * in one call, so the decode is serialized with the device compute.
+ */
+class HailoDetector : public Detector
+{
+public:
+	HailoDetector(const std::string &hefFile, const std::string &classFile, const std::string &deviceID, const float &threshold, const std::vector<std::vector<uint32_t>> &anchors) :
+		m_pYoloHailo(std::make_unique<YoloHailo>(hefFile, classFile, deviceID, threshold, anchors)),
+		m_classNames(LoadClassNames(classFile))
+	{
+	}
+
+	Detections Infer(cv::Mat &img) override
+	{
+		Detections dets;
+		InferInto(img, dets);
+		return dets;
+	}
+
+	/**
+	 * Not free of allocations: YoloHailo::Infer returns its results by value, a new vector per call.
+	 * @param img Preprocessed network input, YoloHailo::Infer still copies it into the device input buffer
+	 */
+	void InferInto(cv::Mat &img, Detections &dets) override
+	{
+		const YoloHailo::YoloResults results = m_pYoloHailo->Infer(img);
+
+		// The labels of the results are not copied, the class ID refers to the class file
+		dets.clear();
+		for (const YoloHailo::YoloResult &res : results)
+			dets.push_back({ static_cast<uint32_t>(res.classID), res.x, res.y, res.w, res.h, res.classProb });
+	}
+
+	const std::vector<std::string> &GetClassNames() const override
+	{
+		return m_classNames;
+	}
+
+	void StartPowerMeasuring() override
+	{
+		m_pYoloHailo->StartPowerMeasuring();
+	}
+
+	float GetAveragePower() override
+	{
+		return m_pYoloHailo->GetAveragePower();
+	}
+
+private:
+	std::unique_ptr<YoloHailo> m_pYoloHailo;
+	std::vector<std::string> m_classNames; // Class file entries, indexed by the class ID minus one
+};
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Pool of inference workers with in-order delivery of the results.
+ *
+ * Typically one or several workers per accelerator, each with its own buffers.
+ * Every worker holds at most one job, so the number of jobs in flight equals
+ * the number of workers and no job waits in a queue of the pool. The single
+ * dispatcher thread blocks in WaitForWorker until a worker is free, frames
+ * arriving in the meantime stay in their latest-frame-wins slots.
+ *
+ * Jobs get a sequence number on submission. Completed jobs are kept in a
+ * reorder buffer and handed to the deliver function strictly in submission
+ * order, so the tracker sees a monotonic frame sequence even if a later job
+ * finishes first on a faster device. Jobs submitted without processing
+ * (e.g. predicted frames) are delivered in the same order.
+ */
+template<typename Job>
+class InferencePool
+{
+	using hires_clock = std::chrono::high_resolution_clock;
+
+public:
+	enum class Scheduling
+	{
+		ROUND_ROBIN,  // Workers take jobs in turn
+		LEAST_LOADED  // Any free worker, the one with the least busy time first
+	};
+
+	using ProcessFn = std::function<void(const std::size_t& worker, Job& job)>;
+	using DeliverFn = std::function<void(Job& job)>;
+
+	/**
+	 * @brief Cumulative statistics of one worker.
+	 */
+	struct WorkerStats
+	{
+		uint64_t jobs   = 0;
+		double busyMSec = 0.0;
+	};
+
+	/**
+	 * @param workers Number of workers, one thread each
+	 * @param scheduling Selection of the worker for the next job
+	 * @param process Called on the worker thread for every job
+	 * @param deliver Called for every job in submission order, on the thread completing it
+	 */
+	InferencePool(const std::size_t& workers, const Scheduling& scheduling, ProcessFn process, DeliverFn deliver) :
+		m_scheduling(scheduling),
+		m_process(std::move(process)),
+		m_deliver(std::move(deliver)),
+		m_workers(),
+		m_mutex(),
+		m_cv(),
+		m_next(0),
+		m_submitted(0),
+		m_stopped(false),
+		m_deliveryMutex(),
+		m_completed(),
+		m_freeNodes(),
+		m_delivered(0)
+	{
+		for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); i++)
+			m_workers.push_back(std::make_unique<Worker>());
+
+		for (std::size_t i = 0; i < m_workers.size(); i++)
+			m_workers[i]->thread = std::thread(&InferencePool::run, this, i);
+	}
+
+	~InferencePool()
+	{
+		Stop();
+	}
+
+	InferencePool(const InferencePool&)            = delete;
+	InferencePool& operator=(const InferencePool&) = delete;
+
+	std::size_t GetWorkerCount() const
+	{
+		return m_workers.size();
+	}
+
+	/**
+	 * @brief Block until the next job can be taken by a worker.
+	 * @return False if the pool has been stopped
+	 */
+	bool WaitForWorker()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this] { return m_stopped || selectWorker().has_value(); });
+		return !m_stopped;
+	}
+
+	/**
+	 * @brief Submit a job, blocks until a worker is free if it has to be processed.
+	 * @param job Job to process and deliver
+	 * @param process False delivers the job in order without a worker
+	 */
+	void Submit(Job&& job, const bool& process = true)
+	{
+		uint64_t seq;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (process)
+				m_cv.wait(lock, [this] { return m_stopped || selectWorker().has_value(); });
+			if (m_stopped) return;
+
+			seq = m_submitted++;
+
+			if (process)
+			{
+				const std::size_t w = *selectWorker();
+				m_workers[w]->job.emplace(seq, std::move(job));
+				m_next = (w + 1) % m_workers.size();
+			}
+		}
+
+		if (process)
+			m_cv.notify_all();
+		else
+			complete(seq, std::move(job));
+	}
+
+	/**
+	 * @brief Stop the workers after their current job, pending jobs are discarded.
+	 */
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopped) return;
+			m_stopped = true;
+		}
+		m_cv.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			if (worker->thread.joinable())
+				worker->thread.join();
+		}
+	}
+
+	WorkerStats GetStats(const std::size_t& worker) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_workers[worker]->stats;
+	}
+
+private:
+	struct Worker
+	{
+		std::optional<std::pair<uint64_t, Job>> job; // Assigned job with its sequence number
+		bool busy = false;
+		WorkerStats stats;
+		std::thread thread;
+	};
+
+	// Worker for the next job, none if the scheduling has to wait, requires m_mutex
+	std::optional<std::size_t> selectWorker() const
+	{
+		const std::size_t n = m_workers.size();
+		auto isFree         = [this](const std::size_t& w) { return !m_workers[w]->job && !m_workers[w]->busy; };
+
+		if (m_scheduling == Scheduling::ROUND_ROBIN)
+			return isFree(m_next) ? std::optional<std::size_t>(m_next) : std::nullopt;
+
+		std::optional<std::size_t> best;
+		for (std::size_t k = 0; k < n; k++)
+		{
+			const std::size_t w = (m_next + k) % n;
+			if (isFree(w) && (!best || m_workers[w]->stats.busyMSec < m_workers[*best]->stats.busyMSec))
+				best = w;
+		}
+
+		return best;
+	}
+
+	void run(const std::size_t w)
+	{
+		Worker& worker = *m_workers[w];
+
+		while (true)
+		{
+			std::pair<uint64_t, Job> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this, &worker] { return m_stopped || worker.job.has_value(); });
+				if (m_stopped) return;
+
+				job = std::move(*worker.job);
+				worker.job.reset();
+				worker.busy = true;
+			}
+
+			const hires_clock::time_point start = hires_clock::now();
+			m_process(w, job.second);
+			const double busyMSec = std::chrono::duration<double, std::milli>(hires_clock::now() - start).count();
+
+			complete(job.first, std::move(job.second));
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				worker.busy = false;
+				worker.stats.jobs++;
+				worker.stats.busyMSec += busyMSec;
+			}
+			m_cv.notify_all();
+		}
+	}
+
+	// Reorder buffer, delivers all jobs that are next in sequence
+	void complete(const uint64_t& seq, Job&& job)
+	{
+		std::lock_guard<std::mutex> lock(m_deliveryMutex);
+
+		// Map nodes of delivered jobs are reused, no allocation per job in steady state
+		if (m_freeNodes.empty())
+			m_completed.emplace(seq, std::move(job));
+		else
+		{
+			auto node = std::move(m_freeNodes.back());
+			m_freeNodes.pop_back();
+			node.key()    = seq;
+			node.mapped() = std::move(job);
+			m_completed.insert(std::move(node));
+		}
+
+		while (!m_completed.empty() && m_completed.begin()->first == m_delivered)
+		{
+			m_deliver(m_completed.begin()->second);
+			m_delivered++;
+			m_freeNodes.push_back(m_completed.extract(m_completed.begin()));
+		}
+	}
+
+private:
+	Scheduling m_scheduling;
+	ProcessFn m_process;
+	DeliverFn m_deliver;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::size_t m_next;    // Worker after the last assigned one
+	uint64_t m_submitted;  // Sequence number of the next job
+	bool m_stopped;
+
+	std::mutex m_deliveryMutex;
+	std::map<uint64_t, Job> m_completed; // Completed jobs waiting for an earlier one
+	std::vector<typename std::map<uint64_t, Job>::node_type> m_freeNodes; // Nodes of delivered jobs, reused
+	uint64_t m_delivered;                // Sequence number of the next job to deliver
+};
@@ -26,43 +26,29 @@
 
 #pragma once
 
+#include <cmath>
 #include <cstdint>
-#include <opencv2/video/tracking.hpp>
 #include <vector>
 
+#include "ConstantVelocityKalmanFilter.h"
 #include "Types.h"
 
 class KalmanBoxTracker
 {
-	static constexpr uint32_t DIM_X = 7;
-	static constexpr uint32_t DIM_Z = 4;
+	using KalmanFilter = ConstantVelocityKalmanFilter;
 
 public:
-	KalmanBoxTracker(const BBox &initRect = BBox(), const std::string &name = "") :
-		m_kf(cv::KalmanFilter(DIM_X, DIM_Z, 0)),
-		m_measurement(cv::Mat::zeros(DIM_Z, 1, CV_32F)),
+	KalmanBoxTracker(const BBox &initRect = BBox(), const uint32_t &classID = 0) :
+		m_kf(),
 		m_timeSinceUpdate(0),
 		m_hits(0),
 		m_hitStreak(0),
 		m_age(0),
 		m_id(s_count++),
-		m_name(name)
+		m_classID(classID)
 	{
-		m_kf.transitionMatrix = (cv::Mat1f(DIM_X, DIM_X) << 1, 0, 0, 0, 1, 0, 0,
-								 0, 1, 0, 0, 0, 1, 0,
-								 0, 0, 1, 0, 0, 0, 1,
-								 0, 0, 0, 1, 0, 0, 0,
-								 0, 0, 0, 0, 1, 0, 0,
-								 0, 0, 0, 0, 0, 1, 0,
-								 0, 0, 0, 0, 0, 0, 1);
-
-		cv::setIdentity(m_kf.measurementMatrix);
-		cv::setIdentity(m_kf.processNoiseCov, cv::Scalar::all(1e-2));
-		cv::setIdentity(m_kf.measurementNoiseCov, cv::Scalar::all(1e-1));
-		cv::setIdentity(m_kf.errorCovPost, cv::Scalar::all(1));
-
 		// initialize state vector with bounding box in [cx,cy,s,r] style
-		initBBMatrix(m_kf.statePost, initRect);
+		m_kf.Init(toMeasurement(initRect));
 	}
 
 	const uint32_t &GetTimeSinceUpdate() const
@@ -93,44 +79,41 @@ public:
 	BBox Predict()
 	{
 		// predict
-		cv::Mat p = m_kf.predict();
+		const KalmanFilter::State &p = m_kf.Predict();
 		m_age++;
 
 		if (m_timeSinceUpdate > 0)
 			m_hitStreak = 0;
 		m_timeSinceUpdate++;
 
-		BBox predictBox = getRectXysr(p.at<float>(0, 0), p.at<float>(1, 0), p.at<float>(2, 0), p.at<float>(3, 0));
+		BBox predictBox = getRectXysr(p[0], p[1], p[2], p[3]);
 
 		return predictBox;
 	}
 
 	// Update the state vector with observed bounding box.
-	void Update(const BBox &bBox, const std::string name)
+	void Update(const BBox &bBox, const uint32_t &classID)
 	{
-		m_name = name;
+		m_classID = classID;
 
 		m_timeSinceUpdate = 0;
 		m_hits++;
 		m_hitStreak++;
 
-		// Measurement
-		initBBMatrix(m_measurement, bBox);
-
-		// Update
-		m_kf.correct(m_measurement);
+		// Measurement + Update
+		m_kf.Correct(toMeasurement(bBox));
 	}
 
 	// Return the current state vector
 	BBox GetState() const
 	{
-		cv::Mat s = m_kf.statePost;
-		return getRectXysr(s.at<float>(0, 0), s.at<float>(1, 0), s.at<float>(2, 0), s.at<float>(3, 0));
+		const KalmanFilter::State &s = m_kf.GetState();
+		return getRectXysr(s[0], s[1], s[2], s[3]);
 	}
 
-	const std::string &GetName() const
+	const uint32_t &GetClassID() const
 	{
-		return m_name;
+		return m_classID;
 	}
 
 	static void ResetCounter()
@@ -139,12 +122,9 @@ public:
 	}
 
 private:
-	void initBBMatrix(cv::Mat &mat, const BBox &bBox)
+	static KalmanFilter::Measurement toMeasurement(const BBox &bBox)
 	{
-		mat.at<float>(0, 0) = bBox.x + bBox.width / 2.0f;
-		mat.at<float>(1, 0) = bBox.y + bBox.height / 2.0f;
-		mat.at<float>(2, 0) = bBox.area();
-		mat.at<float>(3, 0) = bBox.width / bBox.height;
+		return { bBox.x + bBox.width / 2.0f, bBox.y + bBox.height / 2.0f, bBox.area(), bBox.width / bBox.height };
 	}
 
 	BBox getRectXysr(const float &cx, const float &cy, const float &s, const float &r) const
@@ -163,8 +143,7 @@ private:
 	}
 
 private:
-	cv::KalmanFilter m_kf;
-	cv::Mat m_measurement;
+	KalmanFilter m_kf; // Fixed-size filter, state is stored inline
 
 	uint32_t m_timeSinceUpdate;
 	uint32_t m_hits;
@@ -172,9 +151,9 @@ private:
 	uint32_t m_age;
 	uint32_t m_id;
 
-	std::string m_name;
+	uint32_t m_classID; // Class of the last matched detection
 
 	static uint32_t s_count;
 };
 
-uint32_t KalmanBoxTracker::s_count = 0;
\ No newline at end of file
+inline uint32_t KalmanBoxTracker::s_count = 0;
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Lock-free latency histogram with fixed, logarithmically spaced buckets.
+ *
+ * Values are recorded in microseconds. Every power of two is split into four
+ * buckets, so a percentile is reported with at most 25% relative error over
+ * the range from 1 us to about one minute. Recording is a few instructions
+ * and one relaxed atomic increment, any thread may record while another one
+ * takes snapshots.
+ */
+class LatencyHistogram
+{
+	static constexpr uint32_t SUB_BITS    = 2; // 4 buckets per power of two
+	static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BITS;
+	static constexpr uint32_t OCTAVES     = 26; // Up to 2^26 us, about 67 s
+	static constexpr uint32_t BUCKETS     = OCTAVES * SUB_BUCKETS;
+
+public:
+	/**
+	 * @brief Percentiles of the values recorded since the last snapshot, in milliseconds.
+	 */
+	struct Summary
+	{
+		uint64_t count = 0;
+		double p50     = 0.0;
+		double p90     = 0.0;
+		double p99     = 0.0;
+		double max     = 0.0;
+	};
+
+public:
+	LatencyHistogram() :
+		m_buckets(),
+		m_maxUSec(0)
+	{
+		for (std::atomic<uint64_t>& bucket : m_buckets)
+			bucket.store(0, std::memory_order_relaxed);
+	}
+
+	void Record(const std::chrono::nanoseconds& duration)
+	{
+		const int64_t ns    = duration.count();
+		const uint64_t usec = (ns > 0) ? static_cast<uint64_t>(ns) / 1000 : 0;
+		m_buckets[bucketOf(usec)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t max = m_maxUSec.load(std::memory_order_relaxed);
+		while (usec > max && !m_maxUSec.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/**
+	 * @brief Summarize and clear the recorded values.
+	 * Percentiles are reported as the upper bound of their bucket, capped at the maximum.
+	 */
+	Summary Snapshot()
+	{
+		std::array<uint64_t, BUCKETS> counts;
+		Summary summary;
+
+		for (uint32_t b = 0; b < BUCKETS; b++)
+		{
+			counts[b] = m_buckets[b].exchange(0, std::memory_order_relaxed);
+			summary.count += counts[b];
+		}
+
+		const double maxMSec = static_cast<double>(m_maxUSec.exchange(0, std::memory_order_relaxed)) / 1000.0;
+		if (summary.count == 0)
+			return summary;
+
+		summary.max = maxMSec;
+		summary.p50 = percentile(counts, summary.count, 0.50, maxMSec);
+		summary.p90 = percentile(counts, summary.count, 0.90, maxMSec);
+		summary.p99 = percentile(counts, summary.count, 0.99, maxMSec);
+
+		return summary;
+	}
+
+private:
+	static uint32_t bucketOf(const uint64_t& usec)
+	{
+		if (usec < SUB_BUCKETS)
+			return static_cast<uint32_t>(usec);
+
+		// Position of the highest bit selects the octave, the next bits the bucket inside it
+		const uint32_t msb    = 63 - static_cast<uint32_t>(__builtin_clzll(usec));
+		const uint32_t sub    = static_cast<uint32_t>(usec >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+		const uint32_t bucket = (msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+
+		return (bucket < BUCKETS) ? bucket : BUCKETS - 1;
+	}
+
+	// Exclusive upper bound of the bucket in microseconds
+	static uint64_t upperBound(const uint32_t& bucket)
+	{
+		if (bucket < SUB_BUCKETS)
+			return bucket + 1;
+
+		const uint32_t octave = bucket / SUB_BUCKETS - 1 + SUB_BITS;
+		const uint64_t sub    = bucket % SUB_BUCKETS;
+
+		return (static_cast<uint64_t>(SUB_BUCKETS + sub + 1)) << (octave - SUB_BITS);
+	}
+
+	static double percentile(const std::array<uint64_t, BUCKETS>& counts, const uint64_t& total, const double& p, const double& maxMSec)
+	{
+		const uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total - 1));
+		uint64_t seen       = 0;
+
+		for (uint32_t b = 0; b < BUCKETS; b++)
+		{
+			seen += counts[b];
+			if (seen > rank)
+			{
+				const double bound = static_cast<double>(upperBound(b)) / 1000.0;
+				return (bound < maxMSec) ? bound : maxMSec;
+			}
+		}
+
+		return maxMSec;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKETS> m_buckets;
+	std::atomic<uint64_t> m_maxUSec;
+};
+
+/**
+ * @brief Records the lifetime of the object into a latency histogram.
+ */
+class ScopedLatency
+{
+	using clock = std::chrono::steady_clock;
+
+public:
+	explicit ScopedLatency(LatencyHistogram& histogram) :
+		m_histogram(histogram),
+		m_start(clock::now())
+	{
+	}
+
+	~ScopedLatency()
+	{
+		m_histogram.Record(clock::now() - m_start);
+	}
+
+	ScopedLatency(const ScopedLatency&)            = delete;
+	ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+	LatencyHistogram& m_histogram;
+	clock::time_point m_start;
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Solver for the rectangular linear assignment problem with a persistent workspace.
+ *
+ * Takes a flat row-major float cost matrix and assigns every row to at most
+ * one column so that the total cost is minimal. Uses the shortest augmenting
+ * path method of Jonker and Volgenant in the rectangular form described by
+ * Crouse ("On implementing 2D rectangular assignment algorithms", 2016).
+ * All buffers are kept between calls, so solving problems of similar size
+ * every frame does not allocate.
+ *
+ * Fast paths for the common cases:
+ *  - Empty problems (0xN, Nx0)
+ *  - 1x1 problems
+ *  - Problems where the row minima fall into distinct columns, which are
+ *    optimal as is since they reach the lower bound of the total cost
+ */
+class LinearAssignment
+{
+public:
+	using Assignment = std::vector<int32_t>;
+
+public:
+	LinearAssignment() :
+		m_assignment(),
+		m_transposed(),
+		m_u(),
+		m_v(),
+		m_shortestPathCosts(),
+		m_path(),
+		m_col4row(),
+		m_row4col(),
+		m_remaining(),
+		m_visitedRows(),
+		m_visitedCols()
+	{
+	}
+
+	/**
+	 * @brief Reserve the workspace for problems up to the given size, later calls within it do not allocate.
+	 */
+	void Reserve(const std::size_t& rows, const std::size_t& cols)
+	{
+		const std::size_t n = std::max(rows, cols);
+
+		m_assignment.reserve(n);
+		m_transposed.reserve(rows * cols);
+		m_u.reserve(n);
+		m_v.reserve(n);
+		m_shortestPathCosts.reserve(n);
+		m_path.reserve(n);
+		m_col4row.reserve(n);
+		m_row4col.reserve(n);
+		m_remaining.reserve(n);
+		m_visitedRows.reserve(n);
+		m_visitedCols.reserve(n);
+	}
+
+	/**
+	 * @brief Solve the assignment problem for the given cost matrix.
+	 * @param cost Row-major cost matrix with rows * cols entries
+	 * @param rows Number of rows
+	 * @param cols Number of columns
+	 * @return Assigned column for every row, -1 if the row is unassigned. Valid until the next call.
+	 */
+	const Assignment& Solve(const float* cost, const std::size_t& rows, const std::size_t& cols)
+	{
+		m_assignment.assign(rows, -1);
+
+		if (rows == 0 || cols == 0)
+			return m_assignment;
+
+		if (rows == 1 && cols == 1)
+		{
+			m_assignment[0] = 0;
+			return m_assignment;
+		}
+
+		if (rows <= cols)
+		{
+			if (!solveRowMinima(cost, rows, cols))
+				solve(cost, rows, cols);
+
+			for (std::size_t i = 0; i < rows; i++)
+				m_assignment[i] = m_col4row[i];
+		}
+		else
+		{
+			// The solver requires rows <= cols, assign the columns to the rows instead
+			m_transposed.resize(rows * cols);
+			for (std::size_t i = 0; i < rows; i++)
+				for (std::size_t j = 0; j < cols; j++)
+					m_transposed[j * rows + i] = cost[i * cols + j];
+
+			if (!solveRowMinima(m_transposed.data(), cols, rows))
+				solve(m_transposed.data(), cols, rows);
+
+			for (std::size_t j = 0; j < cols; j++)
+				m_assignment[m_col4row[j]] = static_cast<int32_t>(j);
+		}
+
+		return m_assignment;
+	}
+
+	/**
+	 * @brief Total cost of the last assignment for the given cost matrix.
+	 */
+	float GetCost(const float* cost, const std::size_t& cols) const
+	{
+		float total = 0.0f;
+		for (std::size_t i = 0; i < m_assignment.size(); i++)
+		{
+			if (m_assignment[i] >= 0)
+				total += cost[i * cols + m_assignment[i]];
+		}
+
+		return total;
+	}
+
+private:
+	// Assigns every row to its minimum column if these are all distinct, returns false otherwise
+	bool solveRowMinima(const float* cost, const std::size_t& rows, const std::size_t& cols)
+	{
+		m_col4row.resize(rows);
+		m_row4col.assign(cols, -1);
+
+		for (std::size_t i = 0; i < rows; i++)
+		{
+			const float* row = cost + i * cols;
+			std::size_t best = 0;
+			for (std::size_t j = 1; j < cols; j++)
+			{
+				if (row[j] < row[best])
+					best = j;
+			}
+
+			if (m_row4col[best] != -1)
+				return false;
+
+			m_row4col[best] = static_cast<int32_t>(i);
+			m_col4row[i]    = static_cast<int32_t>(best);
+		}
+
+		return true;
+	}
+
+	// Shortest augmenting path solver, requires rows <= cols
+	void solve(const float* cost, const std::size_t& rows, const std::size_t& cols)
+	{
+		constexpr float INF = std::numeric_limits<float>::infinity();
+
+		m_u.assign(rows, 0.0f);
+		m_v.assign(cols, 0.0f);
+		m_shortestPathCosts.resize(cols);
+		m_path.assign(cols, -1);
+		m_col4row.assign(rows, -1);
+		m_row4col.assign(cols, -1);
+		m_remaining.resize(cols);
+		m_visitedRows.resize(rows);
+		m_visitedCols.resize(cols);
+
+		for (std::size_t curRow = 0; curRow < rows; curRow++)
+		{
+			float minVal             = 0.0f;
+			int32_t sink             = -1;
+			std::size_t i            = curRow;
+			std::size_t numRemaining = cols;
+
+			for (std::size_t it = 0; it < cols; it++)
+				m_remaining[it] = static_cast<int32_t>(cols - it - 1);
+
+			std::fill(m_visitedRows.begin(), m_visitedRows.end(), 0);
+			std::fill(m_visitedCols.begin(), m_visitedCols.end(), 0);
+			std::fill(m_shortestPathCosts.begin(), m_shortestPathCosts.end(), INF);
+
+			// Find the shortest augmenting path from the current row to a free column
+			while (sink == -1)
+			{
+				std::size_t index = 0;
+				float lowest      = INF;
+				m_visitedRows[i]  = 1;
+
+				const float* row = cost + i * cols;
+				for (std::size_t it = 0; it < numRemaining; it++)
+				{
+					const int32_t j = m_remaining[it];
+					const float r   = minVal + row[j] - m_u[i] - m_v[j];
+
+					if (r < m_shortestPathCosts[j])
+					{
+						m_path[j]              = static_cast<int32_t>(i);
+						m_shortestPathCosts[j] = r;
+					}
+
+					// Prefer free columns on ties, this ends the search early
+					if (m_shortestPathCosts[j] < lowest || (m_shortestPathCosts[j] == lowest && m_row4col[j] == -1))
+					{
+						lowest = m_shortestPathCosts[j];
+						index  = it;
+					}
+				}
+
+				minVal          = lowest;
+				const int32_t j = m_remaining[index];
+
+				if (m_row4col[j] == -1)
+					sink = j;
+				else
+					i = static_cast<std::size_t>(m_row4col[j]);
+
+				m_visitedCols[j]   = 1;
+				m_remaining[index] = m_remaining[--numRemaining];
+			}
+
+			// Update the dual variables
+			m_u[curRow] += minVal;
+			for (std::size_t r = 0; r < rows; r++)
+			{
+				if (m_visitedRows[r] && r != curRow)
+					m_u[r] += minVal - m_shortestPathCosts[m_col4row[r]];
+			}
+
+			for (std::size_t c = 0; c < cols; c++)
+			{
+				if (m_visitedCols[c])
+					m_v[c] -= minVal - m_shortestPathCosts[c];
+			}
+
+			// Augment the assignment along the path
+			int32_t j = sink;
+			while (true)
+			{
+				const int32_t r = m_path[j];
+				m_row4col[j]    = r;
+				std::swap(m_col4row[r], j);
+				if (r == static_cast<int32_t>(curRow)) break;
+			}
+		}
+	}
+
+private:
+	Assignment m_assignment;
+	std::vector<float> m_transposed;
+
+	// Workspace of the shortest augmenting path solver
+	std::vector<float> m_u; // Row duals
+	std::vector<float> m_v; // Column duals
+	std::vector<float> m_shortestPathCosts;
+	std::vector<int32_t> m_path;
+	std::vector<int32_t> m_col4row;
+	std::vector<int32_t> m_row4col;
+	std::vector<int32_t> m_remaining;
+	std::vector<uint8_t> m_visitedRows;
+	std::vector<uint8_t> m_visitedCols;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <rclcpp/rclcpp.hpp>
+
+/**
+ * @brief Outgoing message of one publisher, filled and published without a heap allocation per call.
+ *
+ * Borrow returns the message to fill:
+ * - a loaned message if the middleware supports loans for the type (shared memory transports, plain types),
+ * - a new message with intra-process communication, it is moved to the subscribers without a copy,
+ * - otherwise the message of the slot itself, which keeps its buffers from the previous call
+ *   and is serialized by the middleware straight from the reference.
+ * Fill functions therefore have to replace all content of the message.
+ */
+template<typename MessageT>
+class MessageSlot
+{
+public:
+	/**
+	 * @param intraProcess The publisher uses intra-process communication
+	 */
+	explicit MessageSlot(const bool& intraProcess = false) :
+		m_intraProcess(intraProcess),
+		m_reused(),
+		m_unique(),
+		m_loaned()
+	{
+	}
+
+	/**
+	 * @param intraProcess The publisher uses intra-process communication
+	 */
+	void SetIntraProcess(const bool& intraProcess)
+	{
+		m_intraProcess = intraProcess;
+	}
+
+	/**
+	 * @brief Message of the slot itself, used when loans are not supported, e.g. to reserve its buffers up front.
+	 */
+	MessageT& GetReused()
+	{
+		return m_reused;
+	}
+
+	MessageT& Borrow(rclcpp::Publisher<MessageT>& publisher)
+	{
+		if (publisher.can_loan_messages())
+		{
+			m_loaned.emplace(publisher.borrow_loaned_message());
+			return m_loaned->get();
+		}
+
+		if (m_intraProcess)
+		{
+			m_unique = std::make_unique<MessageT>();
+			return *m_unique;
+		}
+
+		return m_reused;
+	}
+
+	/**
+	 * @brief The message of the last Borrow stays in the slot when it is published,
+	 * so its content may be moved out after Publish.
+	 */
+	bool KeepsMessage() const
+	{
+		return !m_loaned && !m_unique;
+	}
+
+	/**
+	 * @brief Publish the message returned by the last Borrow.
+	 */
+	void Publish(rclcpp::Publisher<MessageT>& publisher)
+	{
+		if (m_loaned)
+		{
+			rclcpp::LoanedMessage<MessageT> loaned = std::move(*m_loaned);
+			m_loaned.reset();
+			publisher.publish(std::move(loaned));
+		}
+		else if (m_unique)
+			publisher.publish(std::move(m_unique));
+		else
+			publisher.publish(m_reused);
+	}
+
+private:
+	bool m_intraProcess;
+	MessageT m_reused;                                       // Reused message when loans are not supported
+	std::unique_ptr<MessageT> m_unique;                      // New message handed to intra-process subscribers
+	std::optional<rclcpp::LoanedMessage<MessageT>> m_loaned; // Message loaned from the middleware
+};
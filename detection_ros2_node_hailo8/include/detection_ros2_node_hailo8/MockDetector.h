@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Detector.h"
+
+/**
+ * @brief CPU-only detector backend for profiling and testing without a Hailo8.
+ *
+ * Returns either synthetic objects moving through the frame or detections
+ * replayed from a recording. A simulated inference latency with uniform
+ * jitter is added to every call. All randomness is seeded, so runs with the
+ * same configuration are reproducible.
+ *
+ * Replay files contain one detection per line: "frame classID prob x y w h",
+ * lines starting with '#' are ignored. The recording is played in a loop.
+ *
+ * Instances simulating several devices of a worker pool share one frame
+ * counter, so together they present one continuous scene. The counter
+ * advances once per call of InferInto or InferBatch, all inputs of a batch
+ * (the tiles of a frame, the frames of several streams) show the same frame.
+ */
+class MockDetector : public Detector
+{
+	static constexpr std::size_t DEFAULT_CLASS_COUNT = 80;
+
+	struct SyntheticObject
+	{
+		uint32_t classID;
+		float x, y, w, h;
+		float vx, vy;
+	};
+
+public:
+	MockDetector(const std::string &classFile = "", const double &latencyMSec = 0.0, const double &jitterMSec = 0.0, const uint32_t &objectCount = 5,
+				 const uint32_t &seed = 0, const std::string &replayFile = "", const std::shared_ptr<std::atomic<uint64_t>> &frameCounter = nullptr) :
+		m_classNames(LoadClassNames(classFile)),
+		m_latencyMSec(latencyMSec),
+		m_jitterMSec(jitterMSec),
+		m_rng(seed),
+		m_objects(),
+		m_replay(),
+		m_frame(frameCounter ? frameCounter : std::make_shared<std::atomic<uint64_t>>(0)),
+		m_stepped(0)
+	{
+		if (m_classNames.empty())
+		{
+			for (std::size_t i = 0; i < DEFAULT_CLASS_COUNT; i++)
+				m_classNames.push_back("class" + std::to_string(i));
+		}
+
+		if (!replayFile.empty())
+			loadReplay(replayFile);
+
+		std::uniform_real_distribution<float> pos(0.0f, 0.8f);
+		std::uniform_real_distribution<float> size(0.05f, 0.2f);
+		std::uniform_real_distribution<float> vel(-0.01f, 0.01f);
+		std::uniform_int_distribution<uint32_t> cls(1, static_cast<uint32_t>(m_classNames.size()));
+
+		for (uint32_t i = 0; i < objectCount; i++)
+			m_objects.push_back({ cls(m_rng), pos(m_rng), pos(m_rng), size(m_rng), size(m_rng), vel(m_rng), vel(m_rng) });
+	}
+
+	Detections Infer(cv::Mat &img) override
+	{
+		Detections dets;
+		InferInto(img, dets);
+		return dets;
+	}
+
+	void InferInto(cv::Mat &img, Detections &dets) override
+	{
+		(void)img;
+
+		fillFrame((*m_frame)++, dets);
+		simulateLatency();
+	}
+
+	void InferBatch(std::vector<cv::Mat> &imgs, std::vector<Detections> &results) override
+	{
+		const uint64_t frame = (*m_frame)++;
+
+		results.resize(imgs.size());
+		for (Detections &dets : results)
+		{
+			fillFrame(frame, dets);
+			simulateLatency();
+		}
+	}
+
+	const std::vector<std::string> &GetClassNames() const override
+	{
+		return m_classNames;
+	}
+
+private:
+	void fillFrame(const uint64_t &frame, Detections &dets)
+	{
+		if (!m_replay.empty())
+		{
+			dets = m_replay[frame % m_replay.size()];
+			return;
+		}
+
+		// Catch up with the frames inferred by the other instances sharing the counter
+		for (; m_stepped <= frame; m_stepped++)
+		{
+			for (SyntheticObject &obj : m_objects)
+				step(obj);
+		}
+
+		dets.clear();
+		for (const SyntheticObject &obj : m_objects)
+			dets.push_back({ obj.classID, obj.x, obj.y, obj.w, obj.h, 0.9f });
+	}
+
+	void loadReplay(const std::string &replayFile)
+	{
+		std::ifstream file(replayFile);
+		std::string line;
+
+		if (!file.good())
+			throw std::runtime_error("MockDetector: unable to open replay file " + replayFile);
+
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#') continue;
+
+			std::istringstream iss(line);
+			std::size_t frame;
+			Detection det;
+
+			if (!(iss >> frame >> det.classID >> det.classProb >> det.x >> det.y >> det.w >> det.h)) continue;
+			if (det.classID == 0 || det.classID > m_classNames.size()) continue;
+
+			if (m_replay.size() <= frame)
+				m_replay.resize(frame + 1);
+			m_replay[frame].push_back(det);
+		}
+	}
+
+	// Moves a synthetic object, bouncing off the frame borders
+	void step(SyntheticObject &obj)
+	{
+		obj.x += obj.vx;
+		obj.y += obj.vy;
+
+		if (obj.x < 0.0f || obj.x + obj.w > 1.0f)
+		{
+			obj.vx = -obj.vx;
+			obj.x  = std::clamp(obj.x, 0.0f, 1.0f - obj.w);
+		}
+
+		if (obj.y < 0.0f || obj.y + obj.h > 1.0f)
+		{
+			obj.vy = -obj.vy;
+			obj.y  = std::clamp(obj.y, 0.0f, 1.0f - obj.h);
+		}
+	}
+
+	void simulateLatency()
+	{
+		double latency = m_latencyMSec;
+
+		if (m_jitterMSec > 0.0)
+		{
+			std::uniform_real_distribution<double> jitter(-m_jitterMSec, m_jitterMSec);
+			latency += jitter(m_rng);
+		}
+
+		if (latency > 0.0)
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(latency));
+	}
+
+private:
+	std::vector<std::string> m_classNames;
+	double m_latencyMSec;
+	double m_jitterMSec;
+	std::mt19937 m_rng;
+	std::vector<SyntheticObject> m_objects;
+	std::vector<Detections> m_replay; // Recorded detections per frame
+	std::shared_ptr<std::atomic<uint64_t>> m_frame; // Frame counter, shared by the instances of a worker pool
+	uint64_t m_stepped;                             // Frames the synthetic objects have been moved for
+};
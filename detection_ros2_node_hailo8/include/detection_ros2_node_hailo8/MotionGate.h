@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Cheap change detection between the current frame and the last inferred one.
+ *
+ * The frame is reduced to a coarse grid of block means over every second row,
+ * the byte sums of one block row are contiguous and written to be
+ * auto-vectorized. A block counts as changed if its mean differs from the
+ * reference by more than the sensitivity, the frame shows motion if more
+ * than the given fraction of blocks changed.
+ *
+ * The reference is only replaced when a frame is accepted for inference, so
+ * slow changes add up until they are detected.
+ */
+class MotionGate
+{
+	static constexpr uint32_t GRID_W   = 32;
+	static constexpr uint32_t GRID_H   = 24;
+	static constexpr uint32_t BLOCKS   = GRID_W * GRID_H;
+	static constexpr uint32_t ROW_STEP = 2; // Only every second row is sampled
+
+	using Grid = std::array<float, BLOCKS>;
+
+public:
+	/**
+	 * @param sensitivity Change of a block mean in intensity levels that counts as changed block
+	 * @param area Fraction of changed blocks that counts as motion
+	 */
+	MotionGate(const float& sensitivity = 10.0f, const float& area = 0.005f) :
+		m_sensitivity(sensitivity),
+		m_area(area),
+		m_current(),
+		m_reference(),
+		m_hasReference(false),
+		m_changed(1.0f)
+	{
+	}
+
+	void SetSensitivity(const float& sensitivity)
+	{
+		m_sensitivity = sensitivity;
+	}
+
+	float GetSensitivity() const
+	{
+		return m_sensitivity;
+	}
+
+	void SetArea(const float& area)
+	{
+		m_area = area;
+	}
+
+	/**
+	 * @brief Check the frame for changes against the reference.
+	 * @param data First byte of the 8 bit interleaved image
+	 * @param width Width in pixels
+	 * @param height Height in pixels
+	 * @param step Bytes per image row
+	 * @param bytesPerPixel Bytes per pixel, all channels are summed
+	 * @return True if the frame differs from the reference
+	 */
+	bool HasMotion(const uint8_t* data, const uint32_t& width, const uint32_t& height, const std::size_t& step, const uint32_t& bytesPerPixel)
+	{
+		if (width < GRID_W || height < GRID_H)
+			return true;
+
+		computeGrid(data, width, height, step, bytesPerPixel);
+
+		if (!m_hasReference)
+		{
+			m_changed = 1.0f;
+			return true;
+		}
+
+		const float sensitivity = m_sensitivity;
+		uint32_t changed        = 0;
+		for (uint32_t b = 0; b < BLOCKS; b++)
+			changed += (std::fabs(m_current[b] - m_reference[b]) > sensitivity) ? 1 : 0;
+
+		m_changed = static_cast<float>(changed) / static_cast<float>(BLOCKS);
+
+		return m_changed > m_area;
+	}
+
+	/**
+	 * @brief Use the frame of the last HasMotion call as reference, called when it is inferred.
+	 */
+	void Accept()
+	{
+		m_reference    = m_current;
+		m_hasReference = true;
+	}
+
+	/**
+	 * @brief Fraction of changed blocks of the last HasMotion call.
+	 */
+	float GetChangedFraction() const
+	{
+		return m_changed;
+	}
+
+private:
+	void computeGrid(const uint8_t* data, const uint32_t& width, const uint32_t& height, const std::size_t& step, const uint32_t& bytesPerPixel)
+	{
+		// Byte offset of the first column of every block column
+		std::array<uint32_t, GRID_W + 1> colStart;
+		for (uint32_t bx = 0; bx <= GRID_W; bx++)
+			colStart[bx] = (bx * width / GRID_W) * bytesPerPixel;
+
+		std::array<uint32_t, BLOCKS> sums;
+		sums.fill(0);
+
+		for (uint32_t by = 0; by < GRID_H; by++)
+		{
+			const uint32_t y0 = by * height / GRID_H;
+			const uint32_t y1 = (by + 1) * height / GRID_H;
+			uint32_t* rowSums = sums.data() + by * GRID_W;
+
+			for (uint32_t y = y0; y < y1; y += ROW_STEP)
+			{
+				const uint8_t* __restrict row = data + y * step;
+				for (uint32_t bx = 0; bx < GRID_W; bx++)
+				{
+					uint32_t sum = 0;
+					for (uint32_t i = colStart[bx]; i < colStart[bx + 1]; i++)
+						sum += row[i];
+					rowSums[bx] += sum;
+				}
+			}
+		}
+
+		for (uint32_t by = 0; by < GRID_H; by++)
+		{
+			const uint32_t y0   = by * height / GRID_H;
+			const uint32_t y1   = (by + 1) * height / GRID_H;
+			const uint32_t rows = (y1 - y0 + ROW_STEP - 1) / ROW_STEP;
+
+			for (uint32_t bx = 0; bx < GRID_W; bx++)
+			{
+				const uint32_t count        = std::max(rows * (colStart[bx + 1] - colStart[bx]), 1u);
+				m_current[by * GRID_W + bx] = static_cast<float>(sums[by * GRID_W + bx]) / static_cast<float>(count);
+			}
+		}
+	}
+
+private:
+	std::atomic<float> m_sensitivity;
+	std::atomic<float> m_area;
+	Grid m_current;
+	Grid m_reference;
+	bool m_hasReference;
+	float m_changed;
+};
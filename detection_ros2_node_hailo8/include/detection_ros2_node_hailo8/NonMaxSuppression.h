@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Detector.h"
+
+/**
+ * @brief Class-aware greedy merge of the detections of overlapping tiles.
+ *
+ * Two detections of the same class from different tiles are duplicates if their
+ * intersection covers more than the threshold of the smaller box (intersection
+ * over smaller area). Unlike IoU this also matches a box cut off at a tile border
+ * with the complete box of the same object from the neighbouring tile or the full
+ * view. Detections of the same tile are never merged, the per-tile NMS of the
+ * network already kept them as different objects, e.g. a person partly behind
+ * another one. Every group takes at most one detection per tile, keeps class and
+ * score of the most probable one and the union of the boxes, so the complete box
+ * of an object survives instead of a cut one.
+ */
+class NonMaxSuppression
+{
+public:
+	NonMaxSuppression() :
+		m_order(),
+		m_keep(),
+		m_tiles(),
+		m_boxes()
+	{
+	}
+
+	/**
+	 * @brief Merge duplicates in place, the order of the kept detections is preserved.
+	 * @param dets Detections with boxes in a common coordinate system and the tile they come from
+	 * @param threshold Intersection over smaller area above which two detections are duplicates
+	 */
+	void Apply(Detections& dets, const float& threshold)
+	{
+		if (dets.size() < 2)
+			return;
+
+		m_order.resize(dets.size());
+		for (std::size_t i = 0; i < dets.size(); i++)
+			m_order[i] = static_cast<uint32_t>(i);
+
+		// Group by class, most probable first
+		std::sort(m_order.begin(), m_order.end(), [&dets](const uint32_t& a, const uint32_t& b) {
+			if (dets[a].classID != dets[b].classID) return dets[a].classID < dets[b].classID;
+			return dets[a].classProb > dets[b].classProb;
+		});
+
+		m_keep.assign(dets.size(), 1);
+		m_tiles.resize(dets.size());
+		m_boxes.resize(dets.size());
+		for (std::size_t i = 0; i < dets.size(); i++)
+		{
+			m_tiles[i] = tileBit(dets[i]);
+			m_boxes[i] = { dets[i].x, dets[i].y, dets[i].x + dets[i].w, dets[i].y + dets[i].h };
+		}
+
+		for (std::size_t begin = 0; begin < m_order.size();)
+		{
+			std::size_t end = begin + 1;
+			while (end < m_order.size() && dets[m_order[end]].classID == dets[m_order[begin]].classID)
+				end++;
+
+			for (std::size_t i = begin; i < end; i++)
+			{
+				const uint32_t a = m_order[i];
+				if (!m_keep[a]) continue;
+
+				for (std::size_t j = i + 1; j < end; j++)
+				{
+					// The overlap is tested with the original boxes, a growing union would chain separate objects
+					const uint32_t b = m_order[j];
+					if (!m_keep[b] || (m_tiles[a] & tileBit(dets[b])) || overlap(dets[a], dets[b]) <= threshold)
+						continue;
+
+					m_keep[b] = 0;
+					m_tiles[a] |= tileBit(dets[b]);
+
+					Box& box = m_boxes[a];
+					box.x1   = std::min(box.x1, dets[b].x);
+					box.y1   = std::min(box.y1, dets[b].y);
+					box.x2   = std::max(box.x2, dets[b].x + dets[b].w);
+					box.y2   = std::max(box.y2, dets[b].y + dets[b].h);
+				}
+			}
+
+			begin = end;
+		}
+
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < dets.size(); i++)
+		{
+			if (!m_keep[i]) continue;
+
+			Detection& det = dets[kept];
+			if (kept != i) det = std::move(dets[i]);
+
+			const Box& box = m_boxes[i];
+			det.x          = box.x1;
+			det.y          = box.y1;
+			det.w          = box.x2 - box.x1;
+			det.h          = box.y2 - box.y1;
+			kept++;
+		}
+
+		dets.resize(kept);
+	}
+
+private:
+	struct Box
+	{
+		float x1, y1, x2, y2;
+	};
+
+	// Tiles from 63 on share the last bit, they are not merged with each other
+	static uint64_t tileBit(const Detection& det)
+	{
+		return uint64_t(1) << std::min<uint32_t>(det.tile, 63);
+	}
+
+	// Intersection over the area of the smaller box
+	static float overlap(const Detection& a, const Detection& b)
+	{
+		const float w = std::min(a.x + a.w, b.x + b.w) - std::max(a.x, b.x);
+		const float h = std::min(a.y + a.h, b.y + b.h) - std::max(a.y, b.y);
+		if (w <= 0.0f || h <= 0.0f)
+			return 0.0f;
+
+		const float smaller = std::min(a.w * a.h, b.w * b.h);
+		return (smaller > 0.0f) ? (w * h) / smaller : 0.0f;
+	}
+
+private:
+	std::vector<uint32_t> m_order;
+	std::vector<uint8_t> m_keep;
+	std::vector<uint64_t> m_tiles; // Tiles already in the group of a kept detection, one bit per tile
+	std::vector<Box> m_boxes;      // Union of the boxes in the group of a kept detection
+};
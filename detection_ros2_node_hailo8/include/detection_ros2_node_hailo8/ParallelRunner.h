@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Persistent threads running the tasks 0 to n-1 of a call concurrently.
+ *
+ * Task 0 runs on the calling thread, every other task on its own thread, which
+ * is started once and waits for the next call. Run returns after all tasks have
+ * finished and rethrows the first exception of a task. Unlike std::async no
+ * thread and no shared state are created per call.
+ */
+class ParallelRunner
+{
+	using CallFn = void (*)(void* task, const std::size_t& index);
+
+public:
+	/**
+	 * @param tasks Number of tasks per call, tasks - 1 threads are started
+	 */
+	explicit ParallelRunner(const std::size_t& tasks) :
+		m_threads(),
+		m_mutex(),
+		m_start(),
+		m_done(),
+		m_task(nullptr),
+		m_call(nullptr),
+		m_generation(0),
+		m_pending(0),
+		m_error(),
+		m_stopped(false)
+	{
+		for (std::size_t i = 1; i < std::max<std::size_t>(tasks, 1); i++)
+			m_threads.emplace_back(&ParallelRunner::run, this, i);
+	}
+
+	~ParallelRunner()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopped = true;
+		}
+		m_start.notify_all();
+
+		for (std::thread& thread : m_threads)
+			thread.join();
+	}
+
+	ParallelRunner(const ParallelRunner&)            = delete;
+	ParallelRunner& operator=(const ParallelRunner&) = delete;
+
+	std::size_t GetTaskCount() const
+	{
+		return m_threads.size() + 1;
+	}
+
+	/**
+	 * @brief Run task(i) for every task index concurrently and wait for all of them.
+	 * @param task Callable with the task index, shared by all threads
+	 */
+	template<typename Task>
+	void Run(Task& task)
+	{
+		if (m_threads.empty())
+		{
+			task(std::size_t(0));
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_task    = &task;
+			m_call    = [](void* t, const std::size_t& index) { (*static_cast<Task*>(t))(index); };
+			m_pending = m_threads.size();
+			m_error   = nullptr;
+			m_generation++;
+		}
+		m_start.notify_all();
+
+		std::exception_ptr error;
+		try
+		{
+			task(std::size_t(0));
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock, [this] { return m_pending == 0; });
+			if (!error) error = m_error;
+			m_task = nullptr;
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+private:
+	void run(const std::size_t index)
+	{
+		uint64_t generation = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start.wait(lock, [this, &generation] { return m_stopped || m_generation != generation; });
+				if (m_stopped) return;
+				generation = m_generation;
+			}
+
+			std::exception_ptr error;
+			try
+			{
+				m_call(m_task, index);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			bool last;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (error && !m_error) m_error = error;
+				last = (--m_pending == 0);
+			}
+
+			if (last)
+				m_done.notify_one();
+		}
+	}
+
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	void* m_task;          // Callable of the current call
+	CallFn m_call;         // Invokes m_task with a task index
+	uint64_t m_generation; // Incremented per call, wakes the threads
+	std::size_t m_pending; // Threads still running their task of the current call
+	std::exception_ptr m_error;
+	bool m_stopped;
+};
@@ -0,0 +1,600 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Fused preprocessing of raw camera frames into the network input.
+ *
+ * Rotation, letterbox (or stretch) resize, color conversion to BGR and the
+ * uint8 output are done in one pass per output row, writing straight into a
+ * preallocated input buffer:
+ *  1. The rotated source line is converted to BGR (contiguous per-row
+ *     converters for unrotated frames, per-pixel fetch along a column for
+ *     90/270 degree rotation).
+ *  2. The line is resampled horizontally into a fixed point line buffer,
+ *     the two lines needed by consecutive output rows are cached.
+ *  3. Both lines are blended vertically into the output row, a contiguous
+ *     loop that is auto-vectorized.
+ *
+ * Only a region of the frame can be processed, e.g. one tile of a
+ * high-resolution frame, then only that region is converted.
+ *
+ * No full-frame intermediate image is created. Bilinear weights use the
+ * pixel center convention of cv::resize (INTER_LINEAR).
+ */
+class Preprocessor
+{
+	static constexpr int32_t WEIGHT_BITS = 11;
+	static constexpr int32_t WEIGHT_ONE  = 1 << WEIGHT_BITS;
+
+	struct Tap
+	{
+		uint32_t i0;
+		uint32_t i1;
+		int32_t w; // Weight of i1 in 1 / WEIGHT_ONE
+	};
+
+	struct Chroma
+	{
+		int32_t b;
+		int32_t g;
+		int32_t r;
+	};
+
+public:
+	enum class Encoding
+	{
+		BGR8,
+		RGB8,
+		BGRA8,
+		RGBA8,
+		MONO8,
+		UYVY, // ROS "yuv422"
+		YUYV, // ROS "yuv422_yuy2"
+		NV12
+	};
+
+	/**
+	 * @brief Raw frame as received, rows may be padded.
+	 */
+	struct Frame
+	{
+		const uint8_t* data;
+		uint32_t width;
+		uint32_t height;
+		std::size_t step; // Bytes per row (of the luma plane for NV12)
+		Encoding encoding;
+	};
+
+	/**
+	 * @brief Part of the rotated frame to process, in frame pixels. An empty region selects the whole frame.
+	 */
+	struct Region
+	{
+		uint32_t x      = 0;
+		uint32_t y      = 0;
+		uint32_t width  = 0;
+		uint32_t height = 0;
+
+		bool operator==(const Region& other) const
+		{
+			return x == other.x && y == other.y && width == other.width && height == other.height;
+		}
+	};
+
+	/**
+	 * @brief Placement of the region of the rotated frame in the network input, in input pixels.
+	 */
+	struct Geometry
+	{
+		uint32_t frameWidth  = 0; // Rotated frame size
+		uint32_t frameHeight = 0;
+		Region region;            // Processed part of the rotated frame
+		uint32_t contentX    = 0;
+		uint32_t contentY    = 0;
+		uint32_t contentW    = 0;
+		uint32_t contentH    = 0;
+	};
+
+	static constexpr uint8_t PAD_VALUE = 114; // Border color of the letterbox, as used for YOLO training
+
+public:
+	/**
+	 * @param size Width and height of the network input
+	 * @param letterbox Keep the aspect ratio and pad the borders, otherwise the frame is stretched
+	 */
+	Preprocessor(const uint32_t& size, const bool& letterbox) :
+		m_size(size),
+		m_letterbox(letterbox),
+		m_output(static_cast<std::size_t>(size) * size * 3, PAD_VALUE),
+		m_geometry(),
+		m_rotation(0),
+		m_xTaps(),
+		m_yTaps(),
+		m_bgrLine(),
+		m_lines(),
+		m_lineIndex({ -1, -1 })
+	{
+	}
+
+	/**
+	 * @brief Map a ROS image encoding name to the supported encodings.
+	 * @return False if the encoding is not supported
+	 */
+	static bool ParseEncoding(const std::string& name, Encoding& encoding)
+	{
+		static const std::array<std::pair<const char*, Encoding>, 9> NAMES = { { { "bgr8", Encoding::BGR8 },
+																				 { "rgb8", Encoding::RGB8 },
+																				 { "bgra8", Encoding::BGRA8 },
+																				 { "rgba8", Encoding::RGBA8 },
+																				 { "mono8", Encoding::MONO8 },
+																				 { "yuv422", Encoding::UYVY },
+																				 { "uyvy", Encoding::UYVY },
+																				 { "yuv422_yuy2", Encoding::YUYV },
+																				 { "nv12", Encoding::NV12 } } };
+
+		for (const auto& [str, enc] : NAMES)
+		{
+			if (name == str)
+			{
+				encoding = enc;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * @brief Bytes per pixel of the first plane, the luma plane for NV12.
+	 */
+	static uint32_t GetBytesPerPixel(const Encoding& encoding)
+	{
+		switch (encoding)
+		{
+			case Encoding::BGR8:
+			case Encoding::RGB8:
+				return 3;
+			case Encoding::BGRA8:
+			case Encoding::RGBA8:
+				return 4;
+			case Encoding::UYVY:
+			case Encoding::YUYV:
+				return 2;
+			case Encoding::MONO8:
+			case Encoding::NV12:
+			default:
+				return 1;
+		}
+	}
+
+	/**
+	 * @brief Two horizontally adjacent pixels share their chroma, such frames need an even width.
+	 */
+	static bool HasPairedChroma(const Encoding& encoding)
+	{
+		return encoding == Encoding::UYVY || encoding == Encoding::YUYV || encoding == Encoding::NV12;
+	}
+
+	/**
+	 * @brief Minimum number of bytes of a frame with the given layout.
+	 */
+	static std::size_t GetRequiredBytes(const Frame& frame)
+	{
+		const std::size_t rows = (frame.encoding == Encoding::NV12) ? frame.height + (frame.height + 1) / 2 : frame.height;
+		return frame.step * rows;
+	}
+
+	/**
+	 * @brief Preprocess the whole frame into the network input buffer.
+	 * @param frame Raw frame, its data must hold GetRequiredBytes(frame) bytes
+	 * @param rotation Clockwise rotation in degrees, 0, 90, 180 or 270
+	 * @return False if the frame is empty, its rows are shorter than its width or the width is odd for paired chroma
+	 */
+	bool Process(const Frame& frame, const uint32_t& rotation)
+	{
+		return Process(frame, rotation, Region());
+	}
+
+	/**
+	 * @brief Preprocess a region of the frame into the network input buffer.
+	 * @param region Part of the rotated frame, clipped to the frame
+	 * @return False if the frame or the region is empty, the rows are shorter than the frame width or the width is odd for paired chroma
+	 */
+	bool Process(const Frame& frame, const uint32_t& rotation, const Region& region)
+	{
+		if (frame.width == 0 || frame.height == 0 || frame.step < static_cast<std::size_t>(frame.width) * GetBytesPerPixel(frame.encoding))
+			return false;
+
+		// The last pixel pair of a row would read the chroma past the row end
+		if (HasPairedChroma(frame.encoding) && (frame.width & 1))
+			return false;
+
+		const uint32_t rot = (rotation / 90 % 4) * 90;
+		if (!updateGeometry(frame, rot, region))
+			return false;
+
+		uint8_t* out        = m_output.data();
+		const std::size_t n = static_cast<std::size_t>(m_geometry.contentW) * 3;
+
+		for (uint32_t v = 0; v < m_geometry.contentH; v++)
+		{
+			const Tap& tap              = m_yTaps[v];
+			const int32_t* __restrict a = resampledLine(frame, tap.i0, tap.i1);
+			const int32_t* __restrict b = resampledLine(frame, tap.i1, tap.i0);
+			uint8_t* __restrict dst     = out + ((static_cast<std::size_t>(m_geometry.contentY) + v) * m_size + m_geometry.contentX) * 3;
+
+			const int32_t w1 = tap.w;
+			const int32_t w0 = WEIGHT_ONE - w1;
+			for (std::size_t i = 0; i < n; i++)
+				dst[i] = static_cast<uint8_t>((a[i] * w0 + b[i] * w1 + (1 << (2 * WEIGHT_BITS - 1))) >> (2 * WEIGHT_BITS));
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Network input, size x size BGR pixels without row padding.
+	 */
+	uint8_t* GetData()
+	{
+		return m_output.data();
+	}
+
+	uint32_t GetSize() const
+	{
+		return m_size;
+	}
+
+	const Geometry& GetGeometry() const
+	{
+		return m_geometry;
+	}
+
+	/**
+	 * @brief Map a box normalized to the network input to a box normalized to the rotated frame.
+	 */
+	void ToFrame(float& x, float& y, float& w, float& h) const
+	{
+		const Region& r = m_geometry.region;
+
+		// Network input pixels to frame pixels, then normalized to the frame
+		const float sx = static_cast<float>(m_size) * static_cast<float>(r.width) / static_cast<float>(m_geometry.contentW);
+		const float sy = static_cast<float>(m_size) * static_cast<float>(r.height) / static_cast<float>(m_geometry.contentH);
+		const float ox = static_cast<float>(r.x) - static_cast<float>(m_geometry.contentX) * static_cast<float>(r.width) / static_cast<float>(m_geometry.contentW);
+		const float oy = static_cast<float>(r.y) - static_cast<float>(m_geometry.contentY) * static_cast<float>(r.height) / static_cast<float>(m_geometry.contentH);
+		const float fw = static_cast<float>(m_geometry.frameWidth);
+		const float fh = static_cast<float>(m_geometry.frameHeight);
+
+		x = (x * sx + ox) / fw;
+		y = (y * sy + oy) / fh;
+		w = w * sx / fw;
+		h = h * sy / fh;
+	}
+
+private:
+	bool updateGeometry(const Frame& frame, const uint32_t& rotation, const Region& region)
+	{
+		const bool swap   = (rotation == 90 || rotation == 270);
+		const uint32_t fw = swap ? frame.height : frame.width;
+		const uint32_t fh = swap ? frame.width : frame.height;
+
+		Region r = region;
+		if (r.width == 0 || r.height == 0)
+			r = { 0, 0, fw, fh };
+		if (r.x >= fw || r.y >= fh)
+			return false;
+		r.width  = std::min(r.width, fw - r.x);
+		r.height = std::min(r.height, fh - r.y);
+
+		const bool changed = (fw != m_geometry.frameWidth || fh != m_geometry.frameHeight || !(r == m_geometry.region) || rotation != m_rotation);
+
+		// Cached lines are only valid within one frame
+		m_lineIndex = { -1, -1 };
+		m_rotation  = rotation;
+
+		if (!changed)
+			return true;
+
+		Geometry g;
+		g.frameWidth  = fw;
+		g.frameHeight = fh;
+		g.region      = r;
+
+		if (m_letterbox)
+		{
+			const double scale = std::min(static_cast<double>(m_size) / r.width, static_cast<double>(m_size) / r.height);
+			g.contentW         = std::clamp(static_cast<uint32_t>(std::lround(r.width * scale)), 1u, m_size);
+			g.contentH         = std::clamp(static_cast<uint32_t>(std::lround(r.height * scale)), 1u, m_size);
+			g.contentX         = (m_size - g.contentW) / 2;
+			g.contentY         = (m_size - g.contentH) / 2;
+		}
+		else
+		{
+			g.contentW = m_size;
+			g.contentH = m_size;
+		}
+
+		m_geometry = g;
+
+		computeTaps(m_xTaps, r.width, g.contentW);
+		computeTaps(m_yTaps, r.height, g.contentH);
+
+		m_bgrLine.resize(static_cast<std::size_t>(r.width) * 3);
+		for (std::vector<int32_t>& line : m_lines)
+			line.resize(static_cast<std::size_t>(g.contentW) * 3);
+
+		// The borders are never written by Process, fill them once
+		std::fill(m_output.begin(), m_output.end(), PAD_VALUE);
+
+		return true;
+	}
+
+	static void computeTaps(std::vector<Tap>& taps, const uint32_t& src, const uint32_t& dst)
+	{
+		const double scale = static_cast<double>(src) / dst;
+
+		taps.resize(dst);
+		for (uint32_t d = 0; d < dst; d++)
+		{
+			const double s    = std::clamp((d + 0.5) * scale - 0.5, 0.0, static_cast<double>(src - 1));
+			const uint32_t i0 = static_cast<uint32_t>(s);
+			taps[d]           = { i0, std::min(i0 + 1, src - 1), static_cast<int32_t>(std::lround((s - i0) * WEIGHT_ONE)) };
+		}
+	}
+
+	// Horizontally resampled rotated line, keep is the line that must stay cached
+	const int32_t* resampledLine(const Frame& frame, const uint32_t& line, const uint32_t& keep)
+	{
+		for (std::size_t s = 0; s < m_lines.size(); s++)
+		{
+			if (m_lineIndex[s] == static_cast<int64_t>(line))
+				return m_lines[s].data();
+		}
+
+		const std::size_t slot = (m_lineIndex[0] == static_cast<int64_t>(keep)) ? 1 : 0;
+
+		convertLine(frame, m_geometry.region.y + line, m_bgrLine.data());
+
+		const uint8_t* src      = m_bgrLine.data();
+		int32_t* __restrict dst = m_lines[slot].data();
+		for (std::size_t u = 0; u < m_xTaps.size(); u++)
+		{
+			const Tap& tap   = m_xTaps[u];
+			const uint8_t* p = src + tap.i0 * 3;
+			const uint8_t* q = src + tap.i1 * 3;
+			const int32_t w0 = WEIGHT_ONE - tap.w;
+
+			dst[u * 3 + 0] = p[0] * w0 + q[0] * tap.w;
+			dst[u * 3 + 1] = p[1] * w0 + q[1] * tap.w;
+			dst[u * 3 + 2] = p[2] * w0 + q[2] * tap.w;
+		}
+
+		m_lineIndex[slot] = line;
+		return m_lines[slot].data();
+	}
+
+	// Columns of the region of one line of the rotated frame as BGR
+	void convertLine(const Frame& frame, const uint32_t& line, uint8_t* dst) const
+	{
+		const uint32_t x0 = m_geometry.region.x;
+		const uint32_t n  = m_geometry.region.width;
+
+		switch (m_rotation)
+		{
+			case 90:
+				// rotated(x', y') = frame(y', H - 1 - x')
+				for (uint32_t i = 0; i < n; i++)
+					fetchPixel(frame, line, frame.height - 1 - (x0 + i), dst + i * 3);
+				break;
+			case 180:
+				convertRow(frame, frame.height - 1 - line, frame.width - x0 - n, n, dst);
+				for (uint32_t l = 0, r = n - 1; l < r; l++, r--)
+				{
+					std::swap(dst[l * 3 + 0], dst[r * 3 + 0]);
+					std::swap(dst[l * 3 + 1], dst[r * 3 + 1]);
+					std::swap(dst[l * 3 + 2], dst[r * 3 + 2]);
+				}
+				break;
+			case 270:
+				// rotated(x', y') = frame(W - 1 - y', x')
+				for (uint32_t i = 0; i < n; i++)
+					fetchPixel(frame, frame.width - 1 - line, x0 + i, dst + i * 3);
+				break;
+			default:
+				convertRow(frame, line, x0, n, dst);
+				break;
+		}
+	}
+
+	// Contiguous conversion of n pixels of one frame row, starting at column x0, to BGR
+	static void convertRow(const Frame& frame, const uint32_t& y, const uint32_t& x0, const uint32_t& n, uint8_t* __restrict dst)
+	{
+		const uint8_t* __restrict row = frame.data + y * frame.step + static_cast<std::size_t>(x0) * GetBytesPerPixel(frame.encoding);
+		const uint32_t w              = n;
+
+		switch (frame.encoding)
+		{
+			case Encoding::BGR8:
+				std::memcpy(dst, row, static_cast<std::size_t>(w) * 3);
+				break;
+			case Encoding::RGB8:
+				for (uint32_t x = 0; x < w; x++)
+				{
+					dst[x * 3 + 0] = row[x * 3 + 2];
+					dst[x * 3 + 1] = row[x * 3 + 1];
+					dst[x * 3 + 2] = row[x * 3 + 0];
+				}
+				break;
+			case Encoding::BGRA8:
+				for (uint32_t x = 0; x < w; x++)
+				{
+					dst[x * 3 + 0] = row[x * 4 + 0];
+					dst[x * 3 + 1] = row[x * 4 + 1];
+					dst[x * 3 + 2] = row[x * 4 + 2];
+				}
+				break;
+			case Encoding::RGBA8:
+				for (uint32_t x = 0; x < w; x++)
+				{
+					dst[x * 3 + 0] = row[x * 4 + 2];
+					dst[x * 3 + 1] = row[x * 4 + 1];
+					dst[x * 3 + 2] = row[x * 4 + 0];
+				}
+				break;
+			case Encoding::MONO8:
+				for (uint32_t x = 0; x < w; x++)
+				{
+					dst[x * 3 + 0] = row[x];
+					dst[x * 3 + 1] = row[x];
+					dst[x * 3 + 2] = row[x];
+				}
+				break;
+			case Encoding::UYVY:
+				convertYuvRow<Encoding::UYVY>(frame, y, x0, n, dst);
+				break;
+			case Encoding::YUYV:
+				convertYuvRow<Encoding::YUYV>(frame, y, x0, n, dst);
+				break;
+			case Encoding::NV12:
+				convertYuvRow<Encoding::NV12>(frame, y, x0, n, dst);
+				break;
+		}
+	}
+
+	// Two pixels share one U and V sample, an unpaired first or last pixel is fetched alone
+	template <Encoding E>
+	static void convertYuvRow(const Frame& frame, const uint32_t& y, const uint32_t& x0, const uint32_t& n, uint8_t* __restrict dst)
+	{
+		const uint8_t* row = frame.data + y * frame.step;
+		const uint8_t* uv  = (E == Encoding::NV12) ? frame.data + (static_cast<std::size_t>(frame.height) + y / 2) * frame.step : nullptr;
+
+		uint32_t i = 0;
+		if (x0 % 2 && n > 0)
+		{
+			fetchPixel(frame, x0, y, dst);
+			i = 1;
+		}
+
+		for (; i + 1 < n; i += 2)
+		{
+			const uint32_t x = x0 + i;
+			uint8_t* d       = dst + i * 3;
+
+			if constexpr (E == Encoding::UYVY)
+			{
+				const uint8_t* p = row + x * 2;
+				const Chroma c   = toChroma(p[0], p[2]);
+				yuvToBgr(p[1], c, d);
+				yuvToBgr(p[3], c, d + 3);
+			}
+			else if constexpr (E == Encoding::YUYV)
+			{
+				const uint8_t* p = row + x * 2;
+				const Chroma c   = toChroma(p[1], p[3]);
+				yuvToBgr(p[0], c, d);
+				yuvToBgr(p[2], c, d + 3);
+			}
+			else
+			{
+				const Chroma c = toChroma(uv[x], uv[x + 1]);
+				yuvToBgr(row[x], c, d);
+				yuvToBgr(row[x + 1], c, d + 3);
+			}
+		}
+
+		if (i < n) fetchPixel(frame, x0 + i, y, dst + i * 3);
+	}
+
+	// Conversion of a single pixel to BGR, used along columns for rotated frames
+	static void fetchPixel(const Frame& frame, const uint32_t& x, const uint32_t& y, uint8_t* dst)
+	{
+		const uint8_t* row = frame.data + y * frame.step;
+
+		switch (frame.encoding)
+		{
+			case Encoding::BGR8:
+				dst[0] = row[x * 3 + 0];
+				dst[1] = row[x * 3 + 1];
+				dst[2] = row[x * 3 + 2];
+				break;
+			case Encoding::RGB8:
+				dst[0] = row[x * 3 + 2];
+				dst[1] = row[x * 3 + 1];
+				dst[2] = row[x * 3 + 0];
+				break;
+			case Encoding::BGRA8:
+				dst[0] = row[x * 4 + 0];
+				dst[1] = row[x * 4 + 1];
+				dst[2] = row[x * 4 + 2];
+				break;
+			case Encoding::RGBA8:
+				dst[0] = row[x * 4 + 2];
+				dst[1] = row[x * 4 + 1];
+				dst[2] = row[x * 4 + 0];
+				break;
+			case Encoding::MONO8:
+				dst[0] = dst[1] = dst[2] = row[x];
+				break;
+			case Encoding::UYVY:
+			{
+				const uint8_t* p = row + (x & ~1u) * 2;
+				yuvToBgr((x & 1) ? p[3] : p[1], toChroma(p[0], p[2]), dst);
+				break;
+			}
+			case Encoding::YUYV:
+			{
+				const uint8_t* p = row + (x & ~1u) * 2;
+				yuvToBgr((x & 1) ? p[2] : p[0], toChroma(p[1], p[3]), dst);
+				break;
+			}
+			case Encoding::NV12:
+			{
+				const uint8_t* uv = frame.data + (static_cast<std::size_t>(frame.height) + y / 2) * frame.step;
+				yuvToBgr(row[x], toChroma(uv[x & ~1u], uv[(x & ~1u) + 1]), dst);
+				break;
+			}
+		}
+	}
+
+	// BT.601 limited range, integer arithmetic. The chroma terms are shared by two pixels.
+	static Chroma toChroma(const int32_t& u, const int32_t& v)
+	{
+		return { 516 * (u - 128), -100 * (u - 128) - 208 * (v - 128), 409 * (v - 128) };
+	}
+
+	static void yuvToBgr(const int32_t& y, const Chroma& chroma, uint8_t* dst)
+	{
+		const int32_t c = 298 * (y - 16) + 128;
+
+		dst[0] = clampByte((c + chroma.b) >> 8);
+		dst[1] = clampByte((c + chroma.g) >> 8);
+		dst[2] = clampByte((c + chroma.r) >> 8);
+	}
+
+	static uint8_t clampByte(const int32_t& value)
+	{
+		return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+private:
+	uint32_t m_size;
+	bool m_letterbox;
+	std::vector<uint8_t> m_output; // Network input, size x size x 3
+	Geometry m_geometry;
+	uint32_t m_rotation;
+
+	std::vector<Tap> m_xTaps; // Per output column of the content
+	std::vector<Tap> m_yTaps; // Per output row of the content
+
+	// Line buffers
+	std::vector<uint8_t> m_bgrLine;              // Rotated line as BGR
+	std::array<std::vector<int32_t>, 2> m_lines; // Horizontally resampled lines
+	std::array<int64_t, 2> m_lineIndex;          // Rotated line held by each buffer, -1 if none
+};
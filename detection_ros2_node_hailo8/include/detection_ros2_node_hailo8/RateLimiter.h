@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Token bucket limiting the rate at which frames are admitted to inference.
+ *
+ * The bucket is refilled with rate tokens per second up to the burst size,
+ * every admitted frame takes one token. A burst slightly above one token
+ * absorbs the arrival jitter of a camera running at exactly the limit, the
+ * long-term rate never exceeds the limit.
+ *
+ * The rate can be changed from any thread and applies to the next frame,
+ * TryAcquire must only be called from a single thread.
+ */
+class RateLimiter
+{
+	using hires_clock = std::chrono::high_resolution_clock;
+	using time_point  = hires_clock::time_point;
+
+public:
+	/**
+	 * @param rate Admitted frames per second, 0 or less disables the limit
+	 * @param burst Maximum number of tokens
+	 */
+	explicit RateLimiter(const double& rate = 0.0, const double& burst = 2.0) :
+		m_rate(rate),
+		m_burst(std::max(burst, 1.0)),
+		m_tokens(m_burst),
+		m_last(),
+		m_started(false)
+	{
+	}
+
+	void SetRate(const double& rate)
+	{
+		m_rate = rate;
+	}
+
+	double GetRate() const
+	{
+		return m_rate;
+	}
+
+	/**
+	 * @brief Take one token if available.
+	 * @param now Arrival time of the frame
+	 * @return True if the frame is admitted
+	 */
+	bool TryAcquire(const time_point& now)
+	{
+		const double rate = m_rate;
+
+		if (m_started)
+		{
+			const double elapsed = std::chrono::duration<double>(now - m_last).count();
+			m_tokens             = std::min(m_burst, m_tokens + std::max(elapsed, 0.0) * rate);
+		}
+
+		m_last    = now;
+		m_started = true;
+
+		if (rate <= 0.0)
+		{
+			m_tokens = m_burst;
+			return true;
+		}
+
+		if (m_tokens < 1.0)
+			return false;
+
+		m_tokens -= 1.0;
+		return true;
+	}
+
+private:
+	std::atomic<double> m_rate;
+	double m_burst;
+	double m_tokens;
+	time_point m_last;
+	bool m_started;
+};
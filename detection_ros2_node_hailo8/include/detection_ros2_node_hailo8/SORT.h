@@ -27,176 +27,194 @@
 #pragma once
 
 #include <cstdint>
-#include <limits>
-#include <set>
 #include <vector>
 
-#include "HungarianAlgorithm.h"
-#include "KalmanBoxTracker.h"
+#include "SparseAssociation.h"
+#include "TrackBank.h"
 #include "Types.h"
 #include "Utils.h"
 
 class SORT
 {
-	static constexpr double IOU_THRESHOLD = 0.5;
+	static constexpr float IOU_THRESHOLD = 0.5f;
 
 public:
-	SORT(const uint32_t& maxAge = 30, const uint32_t& minHits = 5) :
+	/**
+	 * @param maxAge Frames a track is kept without a matching detection
+	 * @param minHits Consecutive hits until a track is reported
+	 * @param crossClass Match detections to tracks of other classes, for detectors with flickering labels
+	 */
+	SORT(const uint32_t& maxAge = 30, const uint32_t& minHits = 5, const bool& crossClass = false) :
 		m_maxAge(maxAge),
 		m_minHits(minHits),
+		m_crossClass(crossClass),
 		m_trackers(),
-		m_frameCount(0)
+		m_frameCount(0),
+		m_association(),
+		m_predictedBoxes(),
+		m_detMatched()
 	{
 	}
 
+	/**
+	 * @brief Reserve the tracker buffers, frames within these numbers do not allocate.
+	 * Without it the buffers grow to the largest frame seen so far.
+	 * @param tracks Expected maximum number of live tracks
+	 * @param dets Expected maximum number of detections per frame
+	 */
+	void Reserve(const std::size_t& tracks, const std::size_t& dets)
+	{
+		m_trackers.Reserve(tracks);
+		m_association.Reserve(tracks, dets);
+		m_predictedBoxes.reserve(tracks);
+		m_detMatched.reserve(dets);
+	}
+
+	/**
+	 * @brief Track the detections of all classes of one frame.
+	 * The class of a detection is taken from TrackingObject::classID, tracks take the class of their last detection.
+	 */
 	TrackingObjects Update(const TrackingObjects& dets)
 	{
-		m_frameCount++;
+		TrackingObjects tracks;
+		Update(dets, tracks);
+		return tracks;
+	}
 
-		BBox box;
-		BBoxes predictedBoxes;
+	/**
+	 * @brief Track the detections of all classes of one frame into a reused output buffer.
+	 * @param dets Detections of the frame
+	 * @param tracks Reported tracks, replaced, the buffer keeps its capacity
+	 */
+	void Update(const TrackingObjects& dets, TrackingObjects& tracks)
+	{
+		m_frameCount++;
+		tracks.clear();
 
-		if (m_trackers.empty() && dets.empty())
-			return TrackingObjects();
+		if (m_trackers.Empty() && dets.empty())
+			return;
 
-		for (std::vector<KalmanBoxTracker>::iterator it = m_trackers.begin(); it != m_trackers.end();)
-		{
-			box = it->Predict();
-			if (box.x >= 0 && box.y >= 0)
-			{
-				predictedBoxes.push_back(box);
-				it++;
-			}
-			else
-			{
-				it = m_trackers.erase(it);
-			}
-		}
+		// predict all trackers in one pass and drop those that left the frame
+		BBoxes& predictedBoxes = m_predictedBoxes;
+		m_trackers.Predict(predictedBoxes);
+		m_trackers.RemoveIf([&predictedBoxes](const std::size_t& k) { return !(predictedBoxes[k].x >= 0 && predictedBoxes[k].y >= 0); }, &predictedBoxes);
 
 		// =============================================================================
 
-		std::size_t trkNum  = predictedBoxes.size();
-		std::size_t detNum  = dets.size();
-		IOUMatrix iouMatrix = IOUMatrix(trkNum, IOUVector(detNum, 0));
+		// associate only overlapping track/detection pairs of the same class, matches with low IOU are filtered out
+		const std::vector<uint32_t>* pTrackClasses   = m_crossClass ? nullptr : &m_trackers.GetClassIDs();
+		const SparseAssociation::Pairs& matchedPairs = m_association.Associate(predictedBoxes, pTrackClasses, dets, IOU_THRESHOLD);
 
-		for (std::size_t i = 0; i < trkNum; i++)
-		{
-			for (std::size_t j = 0; j < detNum; j++)
-			{
-				iouMatrix[i][j] = 1.0 - getIOU(predictedBoxes[i], dets[j].bBox);
-			}
-		}
+		std::vector<uint8_t>& detMatched = m_detMatched;
+		detMatched.assign(dets.size(), 0);
+		for (const std::pair<uint32_t, uint32_t>& pair : matchedPairs)
+			detMatched[pair.second] = 1;
 
-		std::vector<int32_t> assignment;
-		if (trkNum > 0)
-		{
-			HungarianAlgorithm ha;
-			ha.Solve(iouMatrix, assignment);
-		}
+		// =============================================================================
 
-		std::set<int32_t> unmatchedDetections;
-		std::set<int32_t> allItems;
-		std::set<int32_t> matchedItems;
-		std::vector<cv::Point> matchedPairs;
+		// update matched trackers with assigned detections in one batch.
+		// each prediction is corresponding to a tracker
+		m_trackers.Update(matchedPairs, dets);
 
-		if (detNum > trkNum) //	there are unmatched detections
+		// create and initialise new trackers for unmatched detections
+		for (std::size_t j = 0; j < dets.size(); j++)
 		{
-			for (uint32_t n = 0; n < detNum; n++)
-				allItems.insert(n);
-
-			for (uint32_t i = 0; i < trkNum; i++)
-				matchedItems.insert(assignment[i]);
-
-			std::set_difference(allItems.begin(), allItems.end(), matchedItems.begin(), matchedItems.end(), std::insert_iterator<std::set<int32_t>>(unmatchedDetections, unmatchedDetections.begin()));
+			if (!detMatched[j])
+				m_trackers.Add(dets[j].bBox, dets[j].classID, dets[j].score);
 		}
 
-		// filter out matched with low IOU
-		for (uint32_t i = 0; i < trkNum; i++)
+		// get trackers' output
+		for (std::size_t k = 0; k < m_trackers.Size(); k++)
 		{
-			if (assignment[i] == -1) // pass over invalid values
-				continue;
-
-			if (1 - iouMatrix[i][assignment[i]] < IOU_THRESHOLD)
-			{
-				unmatchedDetections.insert(assignment[i]);
-			}
-			else
-				matchedPairs.push_back(cv::Point(i, assignment[i]));
+			if (isReported(k))
+				report(tracks, k, m_trackers.GetState(k));
 		}
 
-		// =============================================================================
+		// remove dead tracklets
+		m_trackers.RemoveIf([this](const std::size_t& k) { return m_trackers.GetTimeSinceUpdate(k) > m_maxAge; });
+	}
 
-		// update matched trackers with assigned detections.
-		// each prediction is corresponding to a tracker
-		int32_t detIdx;
-		int32_t trkIdx;
-		for (const cv::Point& point : matchedPairs)
-		{
-			trkIdx = point.x;
-			detIdx = point.y;
-			m_trackers[trkIdx].Update(dets[detIdx].bBox, dets[detIdx].name);
-		}
+	/**
+	 * @brief Tracks reported by the last Update, moved on by the given number of frames.
+	 * Used to fill frames that are not processed, the tracker state is not changed.
+	 * @param frames Time since the last Update in frames, may be fractional
+	 */
+	TrackingObjects Extrapolate(const float& frames) const
+	{
+		TrackingObjects tracks;
+		Extrapolate(frames, tracks);
+		return tracks;
+	}
 
-		// create and initialise new trackers for unmatched detections
-		for (auto umd : unmatchedDetections)
+	/**
+	 * @brief Extrapolated tracks into a reused output buffer, see Extrapolate.
+	 */
+	void Extrapolate(const float& frames, TrackingObjects& tracks) const
+	{
+		tracks.clear();
+
+		for (std::size_t k = 0; k < m_trackers.Size(); k++)
 		{
-			KalmanBoxTracker tracker = KalmanBoxTracker(dets[umd].bBox, dets[umd].name);
-			m_trackers.push_back(tracker);
+			if (isReported(k))
+				report(tracks, k, m_trackers.GetExtrapolatedState(k, frames));
 		}
+	}
 
-		TrackingObjects frameTrackingResult;
-
-		// get trackers' output
-		for (std::vector<KalmanBoxTracker>::iterator it = m_trackers.begin(); it != m_trackers.end();)
+	/**
+	 * @brief True if no track of the last frame moves faster than maxSpeed or still waits for confirmation.
+	 * @param maxSpeed Center velocity in box units per frame
+	 */
+	bool IsStatic(const float& maxSpeed) const
+	{
+		for (std::size_t k = 0; k < m_trackers.Size(); k++)
 		{
-			if (it->GetTimeSinceUpdate() < 1 && (it->GetHitStreak() >= m_minHits || m_frameCount <= m_minHits))
-				frameTrackingResult.push_back(TrackingObject(it->GetState(), 0, it->GetName(), it->GetID() + 1));
-
-			// remove dead tracklet
-			if (it != m_trackers.end() && it->GetTimeSinceUpdate() > m_maxAge)
-				it = m_trackers.erase(it);
-			else
-				it++;
+			if (m_trackers.GetTimeSinceUpdate(k) > 0) continue;
+
+			if (m_trackers.GetHitStreak(k) < m_minHits || m_trackers.GetSpeed(k) > maxSpeed)
+				return false;
 		}
 
-		return frameTrackingResult;
+		return true;
 	}
 
 	void ResetCounter() const
 	{
-		KalmanBoxTracker::ResetCounter();
+		TrackBank::ResetCounter();
 	}
 
 	bool IsTrackersEmpty() const
 	{
-		return m_trackers.empty();
+		return m_trackers.Empty();
 	}
 
 	std::size_t GetTrackerCount() const
 	{
-		return m_trackers.size();
+		return m_trackers.Size();
 	}
 
 private:
-	// Computes IOU between two bounding boxes
-	double getIOU(const BBox& bbTest, const BBox& bbGt)
+	// Appends track k with the given box
+	void report(TrackingObjects& tracks, const std::size_t& k, const BBox& box) const
 	{
-		float in = (bbTest & bbGt).area();
-		float un = bbTest.area() + bbGt.area() - in;
-
-		if (un < std::numeric_limits<double>::epsilon())
-			return 0;
-
-		double res = static_cast<double>(in / un);
-		if (res < 0.0) res = 0.0;
-		if (res >= 1.0) res = 1.0;
+		tracks.emplace_back(box, m_trackers.GetScore(k), m_trackers.GetID(k) + 1, m_trackers.GetClassID(k));
+	}
 
-		return res;
+	// Tracks updated in the last frame that have been confirmed by enough hits
+	bool isReported(const std::size_t& k) const
+	{
+		return m_trackers.GetTimeSinceUpdate(k) < 1 && (m_trackers.GetHitStreak(k) >= m_minHits || m_frameCount <= m_minHits);
 	}
 
 private:
 	uint32_t m_maxAge;
 	uint32_t m_minHits;
-	std::vector<KalmanBoxTracker> m_trackers;
+	bool m_crossClass;
+	TrackBank m_trackers; // All tracks in structure-of-arrays form
 	uint32_t m_frameCount;
+
+	SparseAssociation m_association;
+
+	// Per-frame buffers, kept to avoid reallocation
+	BBoxes m_predictedBoxes;
+	std::vector<uint8_t> m_detMatched;
 };
\ No newline at end of file
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "LinearAssignment.h"
+#include "Types.h"
+
+/**
+ * @brief Gated association of predicted track boxes with detections.
+ *
+ * Instead of solving one dense tracks x detections problem, a sweep over the
+ * boxes sorted by class and left edge finds the overlapping track/detection
+ * pairs. Only these pairs have a non-zero IOU. The pairs are split into
+ * connected components, each component is solved on its own.
+ *
+ * The result equals the dense problem with cost 1 - IOU: a pair without
+ * overlap never adds to the total IOU, so the optimum decomposes into the
+ * optimum of every component. The runtime scales with the number of
+ * overlapping pairs instead of cubically with the number of objects.
+ *
+ * Optionally the class acts as a gate as well, then only tracks and
+ * detections of the same class are paired.
+ */
+class SparseAssociation
+{
+	struct Edge
+	{
+		uint32_t track;
+		uint32_t det;
+		float cost; // 1 - IOU
+		uint32_t component;
+	};
+
+	struct SweepEntry
+	{
+		float x0, x1, y0, y1;
+		uint32_t classID;
+		uint32_t index;
+	};
+
+public:
+	using Pairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+public:
+	SparseAssociation() :
+		m_pairs(),
+		m_edges(),
+		m_sweepTracks(),
+		m_sweepDets(),
+		m_parent(),
+		m_localTrack(),
+		m_localDet(),
+		m_compTracks(),
+		m_compDets(),
+		m_cost(),
+		m_solver()
+	{
+	}
+
+	/**
+	 * @brief Reserve the buffers for the given number of tracks and detections.
+	 * Sized for the worst case of all of them overlapping in one component.
+	 */
+	void Reserve(const std::size_t& tracks, const std::size_t& dets)
+	{
+		m_pairs.reserve(std::min(tracks, dets));
+		m_edges.reserve(tracks * dets);
+		m_sweepTracks.reserve(tracks);
+		m_sweepDets.reserve(dets);
+		m_parent.reserve(tracks + dets);
+		m_localTrack.reserve(tracks);
+		m_localDet.reserve(dets);
+		m_compTracks.reserve(tracks);
+		m_compDets.reserve(dets);
+		m_cost.reserve(tracks * dets);
+		m_solver.Reserve(tracks, dets);
+	}
+
+	/**
+	 * @brief Associate the predicted track boxes with the detections.
+	 * @param tracks Predicted box of every track
+	 * @param trackClasses Class of every track, nullptr to pair tracks and detections of different classes
+	 * @param dets Detections of the current frame
+	 * @param iouThreshold Minimum IOU of an accepted pair
+	 * @return Pairs of (track index, detection index) sorted by track index. Valid until the next call.
+	 */
+	const Pairs& Associate(const BBoxes& tracks, const std::vector<uint32_t>* trackClasses, const TrackingObjects& dets, const float& iouThreshold)
+	{
+		m_pairs.clear();
+
+		findCandidates(tracks, trackClasses, dets);
+		if (m_edges.empty())
+			return m_pairs;
+
+		findComponents(tracks.size(), dets.size());
+
+		m_localTrack.assign(tracks.size(), -1);
+		m_localDet.assign(dets.size(), -1);
+
+		for (std::size_t begin = 0; begin < m_edges.size();)
+		{
+			std::size_t end = begin + 1;
+			while (end < m_edges.size() && m_edges[end].component == m_edges[begin].component)
+				end++;
+
+			solveComponent(begin, end, iouThreshold);
+			begin = end;
+		}
+
+		std::sort(m_pairs.begin(), m_pairs.end());
+
+		return m_pairs;
+	}
+
+	/**
+	 * @brief Number of overlapping track/detection pairs found in the last call.
+	 */
+	std::size_t GetCandidateCount() const
+	{
+		return m_edges.size();
+	}
+
+private:
+	// Sweep over the boxes sorted by class and left edge and collect the overlapping pairs
+	void findCandidates(const BBoxes& tracks, const std::vector<uint32_t>* trackClasses, const TrackingObjects& dets)
+	{
+		m_edges.clear();
+		m_sweepTracks.clear();
+		m_sweepDets.clear();
+
+		if (tracks.empty() || dets.empty())
+			return;
+
+		// Without class gate all entries get the same class
+		float maxTrackWidth = 0.0f;
+		for (std::size_t i = 0; i < tracks.size(); i++)
+		{
+			m_sweepTracks.push_back(toEntry(tracks[i], trackClasses ? (*trackClasses)[i] : 0, static_cast<uint32_t>(i)));
+			maxTrackWidth = std::max(maxTrackWidth, tracks[i].width);
+		}
+
+		for (std::size_t j = 0; j < dets.size(); j++)
+			m_sweepDets.push_back(toEntry(dets[j].bBox, trackClasses ? dets[j].classID : 0, static_cast<uint32_t>(j)));
+
+		const auto byClassAndLeftEdge = [](const SweepEntry& a, const SweepEntry& b) { return (a.classID != b.classID) ? (a.classID < b.classID) : (a.x0 < b.x0); };
+		std::sort(m_sweepTracks.begin(), m_sweepTracks.end(), byClassAndLeftEdge);
+		std::sort(m_sweepDets.begin(), m_sweepDets.end(), byClassAndLeftEdge);
+
+		// Window of tracks of the same class that start left of the right edge of the detection and may reach its left edge
+		std::size_t first = 0;
+		for (const SweepEntry& d : m_sweepDets)
+		{
+			while (first < m_sweepTracks.size() && (m_sweepTracks[first].classID < d.classID || (m_sweepTracks[first].classID == d.classID && m_sweepTracks[first].x0 + maxTrackWidth <= d.x0)))
+				first++;
+
+			for (std::size_t k = first; k < m_sweepTracks.size() && m_sweepTracks[k].classID == d.classID && m_sweepTracks[k].x0 < d.x1; k++)
+			{
+				const SweepEntry& t = m_sweepTracks[k];
+
+				// Evaluated without short-circuit, the outcome is hard to predict and branches are expensive
+				if ((d.x0 < t.x1) & (t.y0 < d.y1) & (d.y0 < t.y1))
+				{
+					const float iou = getIOU(tracks[t.index], dets[d.index].bBox);
+					if (iou > 0.0f)
+						m_edges.push_back({ t.index, d.index, 1.0f - iou, 0 });
+				}
+			}
+		}
+	}
+
+	// Union-find over tracks [0, trkNum) and detections [trkNum, trkNum + detNum), groups the edges by component
+	void findComponents(const std::size_t& trkNum, const std::size_t& detNum)
+	{
+		m_parent.resize(trkNum + detNum);
+		for (std::size_t i = 0; i < m_parent.size(); i++)
+			m_parent[i] = static_cast<uint32_t>(i);
+
+		for (const Edge& edge : m_edges)
+		{
+			const uint32_t a = find(edge.track);
+			const uint32_t b = find(static_cast<uint32_t>(trkNum) + edge.det);
+			if (a != b)
+				m_parent[a] = b;
+		}
+
+		for (Edge& edge : m_edges)
+			edge.component = find(edge.track);
+
+		std::sort(m_edges.begin(), m_edges.end(), [](const Edge& a, const Edge& b) { return a.component < b.component; });
+	}
+
+	uint32_t find(uint32_t i)
+	{
+		while (m_parent[i] != i)
+		{
+			m_parent[i] = m_parent[m_parent[i]];
+			i           = m_parent[i];
+		}
+
+		return i;
+	}
+
+	// Solves the component made of the edges [begin, end)
+	void solveComponent(const std::size_t& begin, const std::size_t& end, const float& iouThreshold)
+	{
+		if (end - begin == 1)
+		{
+			const Edge& edge = m_edges[begin];
+			if (1.0f - edge.cost >= iouThreshold)
+				m_pairs.push_back({ edge.track, edge.det });
+			return;
+		}
+
+		m_compTracks.clear();
+		m_compDets.clear();
+
+		for (std::size_t e = begin; e < end; e++)
+		{
+			const Edge& edge = m_edges[e];
+			if (m_localTrack[edge.track] < 0)
+			{
+				m_localTrack[edge.track] = static_cast<int32_t>(m_compTracks.size());
+				m_compTracks.push_back(edge.track);
+			}
+
+			if (m_localDet[edge.det] < 0)
+			{
+				m_localDet[edge.det] = static_cast<int32_t>(m_compDets.size());
+				m_compDets.push_back(edge.det);
+			}
+		}
+
+		const std::size_t rows = m_compTracks.size();
+		const std::size_t cols = m_compDets.size();
+
+		m_cost.assign(rows * cols, 1.0f);
+		for (std::size_t e = begin; e < end; e++)
+			m_cost[m_localTrack[m_edges[e].track] * cols + m_localDet[m_edges[e].det]] = m_edges[e].cost;
+
+		const LinearAssignment::Assignment& assignment = m_solver.Solve(m_cost.data(), rows, cols);
+
+		for (std::size_t i = 0; i < rows; i++)
+		{
+			if (assignment[i] < 0) continue;
+
+			if (1.0f - m_cost[i * cols + assignment[i]] >= iouThreshold)
+				m_pairs.push_back({ m_compTracks[i], m_compDets[assignment[i]] });
+		}
+
+		for (const uint32_t& t : m_compTracks)
+			m_localTrack[t] = -1;
+		for (const uint32_t& d : m_compDets)
+			m_localDet[d] = -1;
+	}
+
+	static SweepEntry toEntry(const BBox& box, const uint32_t& classID, const uint32_t& index)
+	{
+		return { box.x, box.x + box.width, box.y, box.y + box.height, classID, index };
+	}
+
+	// Computes IOU between two bounding boxes
+	static float getIOU(const BBox& bbTest, const BBox& bbGt)
+	{
+		float in = (bbTest & bbGt).area();
+		float un = bbTest.area() + bbGt.area() - in;
+
+		if (un < std::numeric_limits<double>::epsilon())
+			return 0.0f;
+
+		return std::clamp(in / un, 0.0f, 1.0f);
+	}
+
+private:
+	Pairs m_pairs;
+	std::vector<Edge> m_edges; // Overlapping track/detection pairs
+
+	// Sweep state
+	std::vector<SweepEntry> m_sweepTracks;
+	std::vector<SweepEntry> m_sweepDets;
+
+	// Components
+	std::vector<uint32_t> m_parent;
+	std::vector<int32_t> m_localTrack;
+	std::vector<int32_t> m_localDet;
+	std::vector<uint32_t> m_compTracks;
+	std::vector<uint32_t> m_compDets;
+	std::vector<float> m_cost;
+
+	LinearAssignment m_solver;
+};
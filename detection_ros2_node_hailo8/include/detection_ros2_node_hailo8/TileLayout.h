@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Preprocessor.h"
+
+/**
+ * @brief Split of a frame into an overlapping grid of tiles for high-resolution inference.
+ *
+ * Every tile is inferred at the full network input size, so small objects
+ * keep their size in pixels instead of being downscaled with the whole frame.
+ * Neighbouring tiles overlap by the given fraction of the tile size, so an
+ * object on a tile border is completely visible in at least one tile if it is
+ * smaller than the overlap. The optional full view adds the downscaled whole
+ * frame for objects larger than a tile.
+ */
+class TileLayout
+{
+public:
+	/**
+	 * @param cols Number of tile columns, 1 disables tiling in this direction
+	 * @param rows Number of tile rows
+	 * @param overlap Overlap of neighbouring tiles as fraction of the tile size, 0 to 0.9
+	 * @param fullView Add the whole frame as last tile if the frame is tiled
+	 */
+	TileLayout(const uint32_t& cols = 1, const uint32_t& rows = 1, const float& overlap = 0.2f, const bool& fullView = true) :
+		m_cols(std::max(cols, 1u)),
+		m_rows(std::max(rows, 1u)),
+		m_overlap(std::clamp(overlap, 0.0f, 0.9f)),
+		m_fullView(fullView)
+	{
+	}
+
+	bool IsTiled() const
+	{
+		return m_cols * m_rows > 1;
+	}
+
+	/**
+	 * @brief Number of network inputs per frame.
+	 */
+	uint32_t GetTileCount() const
+	{
+		return m_cols * m_rows + ((IsTiled() && m_fullView) ? 1 : 0);
+	}
+
+	/**
+	 * @brief Short description of the layout, e.g. "2x2+full".
+	 */
+	std::string GetName() const
+	{
+		std::string name = std::to_string(m_cols) + "x" + std::to_string(m_rows);
+		if (IsTiled() && m_fullView)
+			name += "+full";
+
+		return name;
+	}
+
+	/**
+	 * @brief Compute the tiles of a frame, row by row, followed by the full view.
+	 * @param width Width of the (rotated) frame
+	 * @param height Height of the (rotated) frame
+	 * @param tiles Output, resized to GetTileCount()
+	 */
+	void Compute(const uint32_t& width, const uint32_t& height, std::vector<Preprocessor::Region>& tiles) const
+	{
+		tiles.clear();
+
+		if (!IsTiled())
+		{
+			tiles.push_back({ 0, 0, width, height });
+			return;
+		}
+
+		for (uint32_t r = 0; r < m_rows; r++)
+		{
+			uint32_t y, h;
+			split(height, m_rows, r, y, h);
+
+			for (uint32_t c = 0; c < m_cols; c++)
+			{
+				uint32_t x, w;
+				split(width, m_cols, c, x, w);
+				tiles.push_back({ x, y, w, h });
+			}
+		}
+
+		if (m_fullView)
+			tiles.push_back({ 0, 0, width, height });
+	}
+
+private:
+	// Offset and size of tile i of n along one axis of the given length
+	void split(const uint32_t& length, const uint32_t& n, const uint32_t& i, uint32_t& offset, uint32_t& size) const
+	{
+		if (n == 1)
+		{
+			offset = 0;
+			size   = length;
+			return;
+		}
+
+		// n tiles of size s with overlap o cover s * (n - (n - 1) * o)
+		const double tile   = static_cast<double>(length) / (n - (n - 1) * static_cast<double>(m_overlap));
+		size                = std::min(static_cast<uint32_t>(std::ceil(tile)), length);
+		const double stride = static_cast<double>(length - size) / (n - 1);
+		offset              = std::min(static_cast<uint32_t>(std::lround(i * stride)), length - size);
+	}
+
+private:
+	uint32_t m_cols;
+	uint32_t m_rows;
+	float m_overlap;
+	bool m_fullView;
+};
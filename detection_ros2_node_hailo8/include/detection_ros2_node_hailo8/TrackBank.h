@@ -0,0 +1,486 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ConstantVelocityKalmanFilter.h"
+#include "Types.h"
+
+/**
+ * @brief Structure-of-arrays storage of all tracks of one SORT instance.
+ *
+ * Every state entry, every unique covariance entry and every counter is kept
+ * in its own contiguous array. Predicting all tracks is a sequence of
+ * branch-free element-wise loops over these arrays, correcting the matched
+ * tracks gathers them into blocks of lanes first. Both are written to be
+ * auto-vectorized by the compiler (NEON on ARM, SSE/AVX on x86).
+ * The filter model is the same as in ConstantVelocityKalmanFilter.
+ */
+class TrackBank
+{
+	using KalmanFilter = ConstantVelocityKalmanFilter;
+
+	static constexpr uint32_t DIM_X    = KalmanFilter::DIM_X;
+	static constexpr uint32_t DIM_Z    = KalmanFilter::DIM_Z;
+	static constexpr uint32_t DIM_COV  = DIM_X * (DIM_X + 1) / 2; // Unique entries of the symmetric covariance
+	static constexpr std::size_t LANES = 8;                       // Tracks corrected together
+
+	using Lanes = std::vector<float>;
+
+	// Index of covariance entry (i, j) in the upper triangle storage
+	static constexpr uint32_t covIdx(const uint32_t& i, const uint32_t& j)
+	{
+		const uint32_t r = (i <= j) ? i : j;
+		const uint32_t c = (i <= j) ? j : i;
+		return r * DIM_X - r * (r - 1) / 2 + (c - r);
+	}
+
+	// P' = F * P * F^T expressed as a sum of old covariance entries per entry
+	struct CovTerm
+	{
+		uint32_t dst;
+		int32_t src[3]; // -1 if unused
+	};
+
+public:
+	TrackBank() :
+		m_x(),
+		m_P(),
+		m_timeSinceUpdate(),
+		m_hits(),
+		m_hitStreak(),
+		m_age(),
+		m_id(),
+		m_classID(),
+		m_score(),
+		m_keep()
+	{
+	}
+
+	/**
+	 * @brief Reserve all arrays for the given number of tracks.
+	 */
+	void Reserve(const std::size_t& tracks)
+	{
+		for (Lanes& l : m_x) l.reserve(tracks);
+		for (Lanes& l : m_P) l.reserve(tracks);
+		m_timeSinceUpdate.reserve(tracks);
+		m_hits.reserve(tracks);
+		m_hitStreak.reserve(tracks);
+		m_age.reserve(tracks);
+		m_id.reserve(tracks);
+		m_classID.reserve(tracks);
+		m_score.reserve(tracks);
+		m_keep.reserve(tracks);
+	}
+
+	std::size_t Size() const
+	{
+		return m_id.size();
+	}
+
+	bool Empty() const
+	{
+		return m_id.empty();
+	}
+
+	/**
+	 * @brief Add a new track initialized with the given box.
+	 */
+	void Add(const BBox& bBox, const uint32_t& classID = 0, const uint32_t& score = 0)
+	{
+		const KalmanFilter::Measurement z = toMeasurement(bBox);
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+			m_x[i].push_back(i < DIM_Z ? z[i] : 0.0f);
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+			for (uint32_t j = i; j < DIM_X; j++)
+				m_P[covIdx(i, j)].push_back(i == j ? KalmanFilter::INITIAL_COV : 0.0f);
+
+		m_timeSinceUpdate.push_back(0);
+		m_hits.push_back(0);
+		m_hitStreak.push_back(0);
+		m_age.push_back(0);
+		m_id.push_back(s_count++);
+		m_classID.push_back(classID);
+		m_score.push_back(score);
+	}
+
+	/**
+	 * @brief Predict all tracks in one pass.
+	 * @param predicted Receives the predicted box of every track
+	 */
+	void Predict(BBoxes& predicted)
+	{
+		const std::size_t n = Size();
+
+		// x = F * x
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			float* __restrict dst       = m_x[i].data();
+			const float* __restrict vel = m_x[i + 4].data();
+			for (std::size_t k = 0; k < n; k++)
+				dst[k] += vel[k];
+		}
+
+		// P = F * P * F^T + Q
+		for (const CovTerm& t : predictTerms())
+		{
+			float* __restrict dst     = m_P[t.dst].data();
+			const float* __restrict a = m_P[t.src[0]].data();
+
+			if (t.src[1] < 0)
+			{
+				for (std::size_t k = 0; k < n; k++)
+					dst[k] += a[k];
+			}
+			else
+			{
+				const float* __restrict b = m_P[t.src[1]].data();
+				const float* __restrict c = m_P[t.src[2]].data();
+				for (std::size_t k = 0; k < n; k++)
+					dst[k] += a[k] + b[k] + c[k];
+			}
+		}
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+		{
+			float* __restrict dst = m_P[covIdx(i, i)].data();
+			for (std::size_t k = 0; k < n; k++)
+				dst[k] += KalmanFilter::PROCESS_NOISE;
+		}
+
+		// Counters
+		uint32_t* __restrict tsu    = m_timeSinceUpdate.data();
+		uint32_t* __restrict streak = m_hitStreak.data();
+		uint32_t* __restrict age    = m_age.data();
+		for (std::size_t k = 0; k < n; k++)
+		{
+			age[k]++;
+			streak[k] = (tsu[k] > 0) ? 0 : streak[k];
+			tsu[k]++;
+		}
+
+		predicted.resize(n);
+		for (std::size_t k = 0; k < n; k++)
+			predicted[k] = getRectXysr(m_x[0][k], m_x[1][k], m_x[2][k], m_x[3][k]);
+	}
+
+	/**
+	 * @brief Correct the given tracks with their assigned detections in one batched pass.
+	 * @param pairs Pairs of (track index, detection index)
+	 * @param dets Detections of the current frame
+	 */
+	void Update(const std::vector<std::pair<uint32_t, uint32_t>>& pairs, const TrackingObjects& dets)
+	{
+		const std::size_t m = pairs.size();
+
+		// Lane base pointers, so the gather and scatter loops do not go through the outer arrays
+		float* xs[DIM_X];
+		float* Ps[DIM_COV];
+		for (uint32_t e = 0; e < DIM_X; e++)
+			xs[e] = m_x[e].data();
+		for (uint32_t e = 0; e < DIM_COV; e++)
+			Ps[e] = m_P[e].data();
+
+		for (std::size_t b = 0; b < m; b += LANES)
+		{
+			const std::size_t n = std::min<std::size_t>(LANES, m - b);
+
+			// Gather a block of matched tracks into lanes, unused lanes are padded with a valid dummy state
+			float x[DIM_X][LANES];
+			float P[DIM_COV][LANES];
+			float z[DIM_Z][LANES];
+
+			for (std::size_t l = 0; l < LANES; l++)
+			{
+				if (l < n)
+				{
+					const uint32_t t = pairs[b + l].first;
+					const KalmanFilter::Measurement zl = toMeasurement(dets[pairs[b + l].second].bBox);
+
+					for (uint32_t e = 0; e < DIM_X; e++)
+						x[e][l] = xs[e][t];
+					for (uint32_t e = 0; e < DIM_COV; e++)
+						P[e][l] = Ps[e][t];
+					for (uint32_t e = 0; e < DIM_Z; e++)
+						z[e][l] = zl[e];
+				}
+				else
+				{
+					for (uint32_t e = 0; e < DIM_X; e++)
+						x[e][l] = 0.0f;
+					for (uint32_t i = 0; i < DIM_X; i++)
+						for (uint32_t j = i; j < DIM_X; j++)
+							P[covIdx(i, j)][l] = (i == j) ? KalmanFilter::INITIAL_COV : 0.0f;
+					for (uint32_t e = 0; e < DIM_Z; e++)
+						z[e][l] = 0.0f;
+				}
+			}
+
+			correctBlock(x, P, z);
+
+			// Scatter back and update the counters
+			for (std::size_t l = 0; l < n; l++)
+			{
+				const uint32_t t = pairs[b + l].first;
+				for (uint32_t e = 0; e < DIM_X; e++)
+					xs[e][t] = x[e][l];
+				for (uint32_t e = 0; e < DIM_COV; e++)
+					Ps[e][t] = P[e][l];
+
+				m_timeSinceUpdate[t] = 0;
+				m_hits[t]++;
+				m_hitStreak[t]++;
+				m_classID[t] = dets[pairs[b + l].second].classID;
+				m_score[t]   = dets[pairs[b + l].second].score;
+			}
+		}
+	}
+
+	/**
+	 * @brief Remove all tracks for which the predicate returns true, keeping the order of the others.
+	 * @param pred Called with the track index
+	 * @param parallel Optional per-track vector that is compacted alongside the tracks
+	 */
+	template<typename Pred>
+	void RemoveIf(Pred pred, BBoxes* parallel = nullptr)
+	{
+		const std::size_t n = Size();
+		m_keep.resize(n);
+
+		bool any = false;
+		for (std::size_t k = 0; k < n; k++)
+		{
+			m_keep[k] = !pred(k);
+			any |= !m_keep[k];
+		}
+
+		if (!any) return;
+
+		for (Lanes& l : m_x) compact(l);
+		for (Lanes& l : m_P) compact(l);
+		compact(m_timeSinceUpdate);
+		compact(m_hits);
+		compact(m_hitStreak);
+		compact(m_age);
+		compact(m_id);
+		compact(m_classID);
+		compact(m_score);
+		if (parallel) compact(*parallel);
+	}
+
+	BBox GetState(const std::size_t& k) const
+	{
+		return getRectXysr(m_x[0][k], m_x[1][k], m_x[2][k], m_x[3][k]);
+	}
+
+	/**
+	 * @brief Box of track k moved on by the given number of frames with the current velocity, the filter is not changed.
+	 */
+	BBox GetExtrapolatedState(const std::size_t& k, const float& frames) const
+	{
+		// A shrinking box must not reach a negative area
+		const float s = m_x[2][k] + frames * m_x[6][k];
+		return getRectXysr(m_x[0][k] + frames * m_x[4][k], m_x[1][k] + frames * m_x[5][k], (s > 0.0f) ? s : m_x[2][k], m_x[3][k]);
+	}
+
+	/**
+	 * @brief Larger of the horizontal and vertical center velocity of track k, in box units per frame.
+	 */
+	float GetSpeed(const std::size_t& k) const
+	{
+		return std::max(std::fabs(m_x[4][k]), std::fabs(m_x[5][k]));
+	}
+
+	const uint32_t& GetTimeSinceUpdate(const std::size_t& k) const
+	{
+		return m_timeSinceUpdate[k];
+	}
+
+	const uint32_t& GetHits(const std::size_t& k) const
+	{
+		return m_hits[k];
+	}
+
+	const uint32_t& GetHitStreak(const std::size_t& k) const
+	{
+		return m_hitStreak[k];
+	}
+
+	const uint32_t& GetAge(const std::size_t& k) const
+	{
+		return m_age[k];
+	}
+
+	const uint32_t& GetID(const std::size_t& k) const
+	{
+		return m_id[k];
+	}
+
+	const uint32_t& GetClassID(const std::size_t& k) const
+	{
+		return m_classID[k];
+	}
+
+	// Score of the last matched detection
+	const uint32_t& GetScore(const std::size_t& k) const
+	{
+		return m_score[k];
+	}
+
+	// Class of every track, parallel to the predicted boxes
+	const std::vector<uint32_t>& GetClassIDs() const
+	{
+		return m_classID;
+	}
+
+	static void ResetCounter()
+	{
+		s_count = 0;
+	}
+
+private:
+	static const std::vector<CovTerm>& predictTerms()
+	{
+		static const std::vector<CovTerm> terms = []() {
+			std::vector<CovTerm> first, rest;
+			for (uint32_t i = 0; i < DIM_X; i++)
+			{
+				for (uint32_t j = i; j < DIM_X; j++)
+				{
+					// Rows / columns 0..2 receive the velocity rows / columns 4..6
+					if (i < 3 && j < 3)
+						first.push_back({ covIdx(i, j), { int32_t(covIdx(i + 4, j)), int32_t(covIdx(i, j + 4)), int32_t(covIdx(i + 4, j + 4)) } });
+					else if (i < 3)
+						rest.push_back({ covIdx(i, j), { int32_t(covIdx(i + 4, j)), -1, -1 } });
+				}
+			}
+
+			// The upper left block reads the cross terms before they are updated
+			first.insert(first.end(), rest.begin(), rest.end());
+			return first;
+		}();
+
+		return terms;
+	}
+
+	// Kalman correction of a block of lanes, same math as ConstantVelocityKalmanFilter::Correct.
+	// Every operation is an inner loop over the lanes, which the compiler turns into SIMD instructions.
+	static void correctBlock(float x[DIM_X][LANES], float P[DIM_COV][LANES], const float z[DIM_Z][LANES])
+	{
+		// S = H * P * H^T + R and its inverse
+		float Si[DIM_Z][DIM_Z][LANES];
+		for (std::size_t l = 0; l < LANES; l++)
+		{
+			float S[DIM_Z][DIM_Z];
+			float inv[DIM_Z][DIM_Z] = {};
+			for (uint32_t i = 0; i < DIM_Z; i++)
+				for (uint32_t j = 0; j < DIM_Z; j++)
+					S[i][j] = P[covIdx(i, j)][l] + ((i == j) ? KalmanFilter::MEASUREMENT_NOISE : 0.0f);
+
+			KalmanFilter::Invert4x4(S, inv);
+
+			for (uint32_t i = 0; i < DIM_Z; i++)
+				for (uint32_t j = 0; j < DIM_Z; j++)
+					Si[i][j][l] = inv[i][j];
+		}
+
+		// K = P * H^T * S^-1
+		float K[DIM_X][DIM_Z][LANES];
+		for (uint32_t i = 0; i < DIM_X; i++)
+		{
+			for (uint32_t j = 0; j < DIM_Z; j++)
+			{
+				for (std::size_t l = 0; l < LANES; l++)
+				{
+					K[i][j][l] = P[covIdx(i, 0)][l] * Si[0][j][l] + P[covIdx(i, 1)][l] * Si[1][j][l] + P[covIdx(i, 2)][l] * Si[2][j][l] + P[covIdx(i, 3)][l] * Si[3][j][l];
+				}
+			}
+		}
+
+		// x = x + K * (z - H * x)
+		float y[DIM_Z][LANES];
+		for (uint32_t i = 0; i < DIM_Z; i++)
+			for (std::size_t l = 0; l < LANES; l++)
+				y[i][l] = z[i][l] - x[i][l];
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+			for (std::size_t l = 0; l < LANES; l++)
+				x[i][l] += K[i][0][l] * y[0][l] + K[i][1][l] * y[1][l] + K[i][2][l] * y[2][l] + K[i][3][l] * y[3][l];
+
+		// P = P - K * H * P, reading the first four columns of P before they are overwritten
+		float PHt[DIM_X][DIM_Z][LANES];
+		for (uint32_t i = 0; i < DIM_X; i++)
+			for (uint32_t j = 0; j < DIM_Z; j++)
+				for (std::size_t l = 0; l < LANES; l++)
+					PHt[i][j][l] = P[covIdx(i, j)][l];
+
+		for (uint32_t i = 0; i < DIM_X; i++)
+		{
+			for (uint32_t j = i; j < DIM_X; j++)
+			{
+				for (std::size_t l = 0; l < LANES; l++)
+				{
+					P[covIdx(i, j)][l] -= K[i][0][l] * PHt[j][0][l] + K[i][1][l] * PHt[j][1][l] + K[i][2][l] * PHt[j][2][l] + K[i][3][l] * PHt[j][3][l];
+				}
+			}
+		}
+	}
+
+	template<typename T>
+	void compact(std::vector<T>& v)
+	{
+		std::size_t dst = 0;
+		for (std::size_t k = 0; k < v.size(); k++)
+		{
+			if (!m_keep[k]) continue;
+			if (dst != k) v[dst] = std::move(v[k]);
+			dst++;
+		}
+		v.resize(dst);
+	}
+
+	static KalmanFilter::Measurement toMeasurement(const BBox& bBox)
+	{
+		return { bBox.x + bBox.width / 2.0f, bBox.y + bBox.height / 2.0f, bBox.area(), bBox.width / bBox.height };
+	}
+
+	static BBox getRectXysr(const float& cx, const float& cy, const float& s, const float& r)
+	{
+		float w = std::sqrt(s * r);
+		float h = s / w;
+		float x = (cx - w / 2.0f);
+		float y = (cy - h / 2.0f);
+
+		if (x < 0.0f && cx > 0.0f)
+			x = 0.0f;
+		if (y < 0.0f && cy > 0.0f)
+			y = 0.0f;
+
+		return BBox(x, y, w, h);
+	}
+
+private:
+	std::array<Lanes, DIM_X> m_x;   // State entries, one array per entry
+	std::array<Lanes, DIM_COV> m_P; // Upper triangle of the covariances, one array per entry
+	std::vector<uint32_t> m_timeSinceUpdate;
+	std::vector<uint32_t> m_hits;
+	std::vector<uint32_t> m_hitStreak;
+	std::vector<uint32_t> m_age;
+	std::vector<uint32_t> m_id;
+	std::vector<uint32_t> m_classID;
+	std::vector<uint32_t> m_score;
+
+	// Workspace, kept to avoid reallocation every frame
+	std::vector<uint8_t> m_keep;
+
+	static uint32_t s_count;
+};
+
+inline uint32_t TrackBank::s_count = 0;
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Types.h"
+
+/**
+ * @brief Change detection between the tracked objects of the current frame and the last published state.
+ *
+ * Every frame is classified into added, updated and removed tracks. A track
+ * only counts as updated if its class changed or one of its box values moved
+ * further than the hysteresis away from the last published value, so box
+ * jitter does not produce events. Small movements accumulate until they pass
+ * the hysteresis, the published state never drifts further than that.
+ *
+ * Every keyframe interval frames a keyframe is due, then the complete state
+ * is published and taken over as reference.
+ */
+class TrackDelta
+{
+	struct PublishedTrack
+	{
+		uint32_t id;
+		uint32_t classID;
+		BBox box;
+	};
+
+	struct CurrentTrack
+	{
+		uint32_t id;
+		uint32_t index;
+	};
+
+public:
+	/**
+	 * @brief Result of one frame.
+	 * added and updated are indices into the tracked objects, removed holds track IDs.
+	 */
+	struct Events
+	{
+		std::vector<uint32_t> added;
+		std::vector<uint32_t> updated;
+		std::vector<uint32_t> removed;
+		bool keyframe = false;
+
+		bool Empty() const
+		{
+			return added.empty() && updated.empty() && removed.empty();
+		}
+	};
+
+public:
+	TrackDelta() :
+		m_events(),
+		m_published(),
+		m_next(),
+		m_current(),
+		m_framesSinceKeyframe(0)
+	{
+	}
+
+	/**
+	 * @brief Reserve the buffers for the given number of tracks, frames within it do not allocate.
+	 */
+	void Reserve(const std::size_t& tracks)
+	{
+		m_events.added.reserve(tracks);
+		m_events.updated.reserve(tracks);
+		m_events.removed.reserve(tracks);
+		m_published.reserve(tracks);
+		m_next.reserve(tracks);
+		m_current.reserve(tracks);
+	}
+
+	/**
+	 * @brief Compare the tracked objects with the last published state and take over the changes.
+	 * @param trackers Tracked objects of the current frame
+	 * @param hysteresis Minimum change of a normalized box value that counts as update, 0 reports every change
+	 * @param keyframeInterval Frames between two keyframes, 0 disables keyframes
+	 * @return Events of this frame. Valid until the next call.
+	 */
+	const Events& Update(const TrackingObjects& trackers, const float& hysteresis, const uint32_t& keyframeInterval)
+	{
+		m_events.added.clear();
+		m_events.updated.clear();
+		m_events.removed.clear();
+
+		m_framesSinceKeyframe++;
+		m_events.keyframe = (keyframeInterval > 0 && m_framesSinceKeyframe >= keyframeInterval);
+		if (m_events.keyframe)
+			m_framesSinceKeyframe = 0;
+
+		// SORT reports its tracks ordered by ID in practice, sorting keeps the merge below correct in any case
+		m_current.clear();
+		for (std::size_t i = 0; i < trackers.size(); i++)
+			m_current.push_back({ trackers[i].trackingID, static_cast<uint32_t>(i) });
+
+		std::sort(m_current.begin(), m_current.end(), [](const CurrentTrack& a, const CurrentTrack& b) { return a.id < b.id; });
+
+		// Merge the current tracks with the published ones, both sorted by ID
+		m_next.clear();
+		std::size_t p = 0;
+		for (const CurrentTrack& cur : m_current)
+		{
+			const TrackingObject& t = trackers[cur.index];
+
+			for (; p < m_published.size() && m_published[p].id < cur.id; p++)
+				m_events.removed.push_back(m_published[p].id);
+
+			if (p < m_published.size() && m_published[p].id == cur.id)
+			{
+				const PublishedTrack& last = m_published[p++];
+				if (m_events.keyframe || changed(last, t, hysteresis))
+				{
+					m_events.updated.push_back(cur.index);
+					m_next.push_back({ cur.id, t.classID, t.bBox });
+				}
+				else
+					m_next.push_back(last);
+			}
+			else
+			{
+				m_events.added.push_back(cur.index);
+				m_next.push_back({ cur.id, t.classID, t.bBox });
+			}
+		}
+
+		for (; p < m_published.size(); p++)
+			m_events.removed.push_back(m_published[p].id);
+
+		std::swap(m_published, m_next);
+
+		return m_events;
+	}
+
+	/**
+	 * @brief Forget the published state, the next frame reports all tracks as added.
+	 */
+	void Reset()
+	{
+		m_published.clear();
+		m_framesSinceKeyframe = 0;
+	}
+
+private:
+	static bool changed(const PublishedTrack& last, const TrackingObject& t, const float& hysteresis)
+	{
+		if (last.classID != t.classID) return true;
+
+		return std::fabs(last.box.x - t.bBox.x) > hysteresis || std::fabs(last.box.y - t.bBox.y) > hysteresis || std::fabs(last.box.width - t.bBox.width) > hysteresis
+			   || std::fabs(last.box.height - t.bBox.height) > hysteresis;
+	}
+
+private:
+	Events m_events;
+	std::vector<PublishedTrack> m_published; // Last published state, sorted by ID
+	std::vector<PublishedTrack> m_next;
+	std::vector<CurrentTrack> m_current;
+	uint32_t m_framesSinceKeyframe;
+};
@@ -35,110 +35,40 @@
 using BBox   = cv::Rect2f;
 using BBoxes = std::vector<BBox>;
 
-#ifndef THRESHOLDED_DIFF
-#ifdef DIFF_THRESHOLD // In case THRESHOLDED_DIFF is not defined but DIFF_THRESHOLD is defined, define THRESHOLDED_DIFF
-#define THRESHOLDED_DIFF
-#else
-#define STRICT_DIFF // Else define STRICT_DIFF
-#endif
-#endif
-
-#if defined(THRESHOLDED_DIFF) && defined(STRICT_DIFF)
-#warning "Both THRESHOLDED_DIFF and STRICT_DIFF are defined, using THRESHOLDED_DIFF"
-#undef STRICT_DIFF
-#endif
-
-#ifndef DIFF_THRESHOLD
-#define DIFF_THRESHOLD 0.005
-#endif
-
-#ifdef THRESHOLDED_DIFF
-#define THRESHED_CMP(a, b, OP) (std::fabs(a - b) OP DIFF_THRESHOLD)
-#else
-#define THRESHED_CMP(a, b, OP) (a == b)
-#endif
-
+/**
+ * @brief Detection or track record passed through tracking and serialization.
+ * Plain data without owned memory, so copying it and reusing vectors of it never allocates.
+ * The class is an ID into the class file, names are only resolved when serializing (see GetClassName).
+ */
 struct TrackingObject
 {
-	TrackingObject() :
-		bBox(),
-		score(0),
-		trackingID(0),
-		faceID(0),
-		name("Unknown"),
-		lastCheck(0),
-		lastUpdate(0),
-		face()
-	{
-	}
+	TrackingObject() = default;
 
-	TrackingObject(const BBox& box, const uint32_t& s, const uint32_t& tID = 0) :
+	TrackingObject(const BBox& box, const uint32_t& s, const uint32_t& tID = 0, const uint32_t& cID = 0) :
 		bBox(box),
 		score(s),
 		trackingID(tID),
-		faceID(0),
-		name("Unknown"),
-		lastCheck(-1),
-		lastUpdate(0),
-		face()
+		classID(cID)
 	{
 	}
 
-	TrackingObject(const BBox& box, const uint32_t& s, const std::string& nName, const uint32_t& tID = 0) :
-		bBox(box),
-		score(s),
-		trackingID(tID),
-		faceID(0),
-		name(nName),
-		lastCheck(-1),
-		lastUpdate(0),
-		face()
-	{
-	}
-
-	bool operator!=(const TrackingObject& rhs)
-	{
-		if (this->trackingID != rhs.trackingID) return true;
-		if (this->name != rhs.name) return true;
-#ifdef THRESHOLDED_DIFF
-		if (THRESHED_CMP(this->bBox.x, rhs.bBox.x, >=)) return true;
-		if (THRESHED_CMP(this->bBox.y, rhs.bBox.y, >=)) return true;
-		if (THRESHED_CMP(this->bBox.width, rhs.bBox.width, >=)) return true;
-		if (THRESHED_CMP(this->bBox.height, rhs.bBox.height, >=)) return true;
-#endif
-#ifdef STRICT_DIFF
-		return this->bBox != rhs.bBox;
-#endif
-
-		return false;
-	}
-
-	bool Valid() const
-	{
-		return lastUpdate < 5;
-	}
-
-	bool CmpNameAndXY(const TrackingObject& rhs)
-	{
-		if (this->name != rhs.name) return false;
-		if (THRESHED_CMP(this->bBox.x, rhs.bBox.x, >=)) return false;
-		if (THRESHED_CMP(this->bBox.y, rhs.bBox.y, >=)) return false;
-
-		return true;
-	}
-
 	BBox bBox;
-	uint32_t score;
-	uint32_t trackingID;
-	uint32_t faceID;
-	std::string name;
-	int32_t lastCheck;
-	uint32_t lastUpdate;
-	cv::Mat face;
+	uint32_t score      = 0;
+	uint32_t trackingID = 0;
+	uint32_t classID    = 0; // 1-based class index into the class file, 0 if unknown
 };
 
 using TrackingObjects = std::vector<TrackingObject>;
 
+/**
+ * @brief Name of a 1-based class ID, "Unknown" if the ID is not part of the class file.
+ */
+inline const std::string& GetClassName(const std::vector<std::string>& classNames, const uint32_t& classID)
+{
+	static const std::string UNKNOWN = "Unknown";
+	return (classID > 0 && classID <= classNames.size()) ? classNames[classID - 1] : UNKNOWN;
+}
+
 using IOUType   = double;
 using IOUVector = std::vector<IOUType>;
 using IOUMatrix = std::vector<IOUVector>;
\ No newline at end of file
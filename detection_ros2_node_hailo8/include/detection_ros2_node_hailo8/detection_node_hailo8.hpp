@@ -1,23 +1,46 @@
 #pragma once
 // SYSTEM
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 // ROS
 #include <rclcpp/rclcpp.hpp>
 #include <sensor_msgs/msg/image.hpp>
 #include "std_msgs/msg/string.hpp"
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 // OPENCV
 #include <opencv2/opencv.hpp>
 
 // PROJECT
 
+#include "detection_interfaces/msg/detection_array.hpp"
+#include "detection_interfaces/msg/detection_delta.hpp"
 #include "sm_interfaces/msg/string_stamped.hpp"
 
+#include "BoundedQueue.h"
+#include "BufferPool.h"
+#include "DetectionJson.h"
+#include "Detector.h"
+#include "FrameBatcher.h"
+#include "FramePath.h"
+#include "InferencePool.h"
+#include "LatencyHistogram.h"
+#include "MessageSlot.h"
+#include "MotionGate.h"
+#include "Preprocessor.h"
+#include "RateLimiter.h"
+#include "SORT.h"
+#include "TileLayout.h"
+#include "TrackDelta.h"
 #include "Types.h"
 #include "Timer.h"
 
-#include "YoloHailo.h"
-
 /**
  * @brief Image viewer node class for receiving and visualizing fused image.
  */
@@ -26,28 +49,120 @@ class DetectionNodeHailo8 : public rclcpp::Node
 	typedef std::chrono::high_resolution_clock::time_point time_point;
 	typedef std::chrono::high_resolution_clock hires_clock;
 
+	/**
+	 * @brief Tracking state and outputs of one hosted model for one input stream.
+	 */
+	struct ModelContext
+	{
+		NetworkContext *network = nullptr;      // Model producing the detections
+		std::unique_ptr<ModelTracks> tracks;    // Tracker, change detection and content of the outputs
+		std::string AMOUNT_STR, FPS_STR;
+		std::string jsonBuffer;                 // Serialization buffer used when only printing the detections
+		bool publishJson = true;                // Publish the JSON string topics in addition to the typed detections
+		bool publishDelta = false;              // Publish added/updated/removed events on the delta topic
+
+		// Outgoing messages, loaned or reused for every frame
+		MessageSlot<detection_interfaces::msg::DetectionArray> arrayMessage;
+		MessageSlot<detection_interfaces::msg::DetectionDelta> deltaMessage;
+		MessageSlot<std_msgs::msg::String> jsonMessage;
+		MessageSlot<sm_interfaces::msg::StringStamped> jsonStampedMessage;
+
+		rclcpp::Publisher<detection_interfaces::msg::DetectionArray>::SharedPtr detectionArray_publisher = nullptr;
+		rclcpp::Publisher<detection_interfaces::msg::DetectionDelta>::SharedPtr detectionDelta_publisher = nullptr;
+		rclcpp::Publisher<std_msgs::msg::String>::SharedPtr 			detection_publisher 		= nullptr;
+		rclcpp::Publisher<sm_interfaces::msg::StringStamped>::SharedPtr detectionStamped_publisher 	= nullptr;
+		rclcpp::Publisher<std_msgs::msg::String>::SharedPtr 			fps_publisher 				= nullptr;
+		rclcpp::Publisher<std_msgs::msg::String>::SharedPtr 			power_publisher				= nullptr;
+	};
+
+	/**
+	 * @brief Frame handed from the subscription callback to the inference stage.
+	 */
+	struct FrameJob
+	{
+		sensor_msgs::msg::Image::ConstSharedPtr msg;
+		time_point received;
+	};
+
+	/**
+	 * @brief Input topic with its own preprocessing, admission state, trackers and outputs.
+	 */
+	struct StreamContext
+	{
+		std::string name;                                  // Suffix of the output topics, empty for a single stream
+		std::vector<std::unique_ptr<ModelContext>> models; // One per hosted model, in the order of m_networks
+		rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr subscription;
+
+		RateLimiter rateLimiter;                      // Enforces max_fps before any preprocessing or inference
+		MotionGate motionGate;
+		uint32_t framesSinceInference = 0;
+		std::atomic<bool> tracksMoving{true};         // Set by the tracking stage, moving tracks need inference
+		std::atomic<uint64_t> motionSkippedFrames{0};
+		uint64_t motionSkippedReported = 0;           // Motion skipped frames at the last FPS report
+
+		std::atomic<uint64_t> frameCnt{0};            // Tracked frames since the last FPS report
+		time_point lastInferenceTime;                 // Arrival time of the last inferred frame
+		double inferenceIntervalMSec = 0.0;           // Time between the last two inferred frames
+	};
+
 public:
-	DetectionNodeHailo8(const std::string &name);
+	DetectionNodeHailo8(const std::string &name, const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
+	explicit DetectionNodeHailo8(const rclcpp::NodeOptions &options);
+	~DetectionNodeHailo8();
 	void init();
 
 private:
 
-	uint64_t m_frameCnt = 0;
+	std::atomic<float> m_maxFPS{0.0f};
+	std::atomic<uint64_t> m_skippedFrames{0};     // Frames not inferred because of max_fps
+	bool m_publishPredicted = false;              // Publish extrapolated tracks for skipped frames
+
+	//  ========= Diagnostics =========
+	StageLatencies m_latency;
+	rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr m_diagnostics_publisher = nullptr;
+	rclcpp::TimerBase::SharedPtr m_diagnostics_timer = nullptr;
+
+	//  ========= Callback groups =========
+	// Parameter services stay in the default group of the node, so no callback group waits for another
+	rclcpp::CallbackGroup::SharedPtr m_imageGroup;     // Image subscriptions, mutually exclusive as they share the admission state
+	rclcpp::CallbackGroup::SharedPtr m_telemetryGroup; // FPS/power and diagnostics timers
+
+	//  ========= Motion gating =========
+	bool m_motionGating = false;                  // Skip inference while the scene is static, per stream
+	uint32_t m_motionRefreshInterval = 15;        // Inference is forced after this many skipped frames
+
+	//  ========= Preprocessing =========
+	int m_image_rotation;                         // Clockwise rotation of the input frames in degrees
+	bool m_letterbox = true;                      // Keep the aspect ratio, otherwise frames are stretched to the input size
+	TileLayout m_tileLayout;                      // Overlapping grid for high-resolution frames, a single tile by default
+	float m_tileMergeThreshold = 0.5f;            // Intersection over smaller area above which detections of different tiles are merged
 
-	float m_maxFPS;
-	int m_image_rotation;
 	bool m_print_detections, m_print_fps;
-	std::string m_DETECT_STR, m_AMOUNT_STR, m_FPS_STR, m_last_str;
+	std::string m_last_str;
+	std::atomic<float> m_deltaHysteresis{0.0f};    // Minimum box change that counts as track update
+	std::atomic<uint32_t> m_keyframeInterval{30}; // Frames between two full snapshots, 0 disables them
 
-	Timer m_timer;        // Timer used to measure the time required for one iteration
-	double m_elapsedTime; // Sum of the elapsed time, used to check if one second has passed
+	Timer m_timer;                                // Measures the period of the FPS report
+	rclcpp::TimerBase::SharedPtr m_fps_timer = nullptr;
+	std::atomic<double> m_frameIntervalMSec{0.0}; // Time between the last two tracked frames
 	
 	//  ========= Yolo Node =========
-	TrackingObjects m_lastTrackings; // Vector containing the last tracked objects
-	class SORT* m_pSortTrackers;           // Pointer to n-sort trackers (n = number of classes)
-
-	class YoloHailo* m_pYoloHailo8;
-	YoloHailo::YoloResults m_yoloHailoResults; 
+	std::vector<std::unique_ptr<NetworkContext>> m_networks; // All models, every model is run on every stream
+	std::vector<std::unique_ptr<StreamContext>> m_streams;   // Input topics, each with its own trackers and outputs
+
+	//  ========= Pipeline =========
+	std::unique_ptr<FrameBatcher<FrameJob>> m_frameBatcher;       // Latest-frame-wins slot per stream between callbacks and inference
+	std::unique_ptr<InferenceStage> m_inference;                  // Worker buffers, result pools and the queue to the tracking stage
+	std::unique_ptr<InferencePool<InferenceBatch>> m_pool;        // Runs the batches on the workers, delivers them in order
+	bool m_intraProcessOutputs = false;             // Detection topics are delivered intra-process instead of loaned or reused
+	std::chrono::microseconds m_batchWindow{0};     // Time to wait for the frames of the other streams
+	uint64_t m_batchesReported = 0;
+	uint64_t m_batchedFramesReported = 0;
+	std::thread m_inferenceThread;
+	std::thread m_trackingThread;
+	std::atomic<double> m_queueAgeMSec{0.0};        // Time the last frame waited before inference started
+	std::atomic<double> m_maxFrameAgeMSec{0.0};     // Frames older than this are dropped, 0 disables the deadline
+	std::atomic<uint64_t> m_staleFrames{0};         // Frames dropped because of the deadline
 
 	std::string m_window_name_image_small	= "Image_small_Frame";
 
@@ -59,27 +174,25 @@ private:
 	double m_loop_duration_image_small = 0.0;
 	double m_loop_duration_depth = 0.0;
 
-	int m_framesSincePublish = 0;
-
 	rclcpp::QoS m_qos_profile = rclcpp::SystemDefaultsQoS();
 	rclcpp::QoS m_qos_profile_sysdef = rclcpp::SystemDefaultsQoS();
 	
-	rclcpp::Publisher<std_msgs::msg::String>::SharedPtr 			m_detection_publisher 			= nullptr;
-	rclcpp::Publisher<sm_interfaces::msg::StringStamped>::SharedPtr m_detectionStamped_publisher 	= nullptr;
-	rclcpp::Publisher<std_msgs::msg::String>::SharedPtr 			m_fps_publisher 				= nullptr;
-	rclcpp::Publisher<std_msgs::msg::String>::SharedPtr 			m_power_publisher				= nullptr;
-
-	rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr m_image_small_subscription;
-
 	OnSetParametersCallbackHandle::SharedPtr callback_handle_;
 
-	void imageSmallCallback(sensor_msgs::msg::Image::SharedPtr img_msg);
+	void imageSmallCallback(sensor_msgs::msg::Image::ConstSharedPtr img_msg, const std::size_t stream);
+	void inferenceLoop();
+	bool isStale(const std_msgs::msg::Header &header, const time_point &received);
+	void trackingLoop();
 
 	rcl_interfaces::msg::SetParametersResult parametersCallback(const std::vector<rclcpp::Parameter> &parameters);
-	void ProcessDetections();
-	void ProcessNextFrame(cv::Mat &img);
-	BBox toCenter(const BBox& bBox);
-	void printDetections(const TrackingObjects& trackers);
-	void CheckFPS(uint64_t* pFrameCnt);
-	void PrintFPS(const float fps, const float itrTime);
+	void initModel(NetworkContext &network, const std::string &prefix);
+	void ProcessDetections(ModelContext &model, const Detections &results, const FrameInfo &frame);
+	void ProcessPrediction(ModelContext &model, const FrameInfo &frame, const float frames);
+	void publishTracks(ModelContext &model, const TrackDelta::Events &events, const FrameInfo &frame);
+	void deliverBatch(InferenceBatch &batch);
+	void printDetections(ModelContext &model, const FrameInfo &frame);
+	void publishDelta(ModelContext &model, const TrackDelta::Events &events, const FrameInfo &frame);
+	void publishFPS();
+	void publishDiagnostics();
+	void PrintFPS(ModelContext &model, FpsStats stats);
 };
@@ -0,0 +1,86 @@
+import os
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, OpaqueFunction
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
+from launch import actions
+
+ROS_DISTRO = os.getenv('ROS_DISTRO')
+if not ((ROS_DISTRO == "foxy") or (ROS_DISTRO == "humble")):
+	print("ROS2 distribution " + ROS_DISTRO + " not supported by the container launch file!")
+	actions.Shutdown(reason="ROS2 distribution " + ROS_DISTRO + " not supported by the container launch file!")
+
+# Loads the camera, object and gesture detection nodes into one process,
+# images are passed between them via zero-copy intra-process communication.
+# The camera node is only loaded if camera_package and camera_plugin are given.
+
+def launch_setup(context, *args, **kwargs):
+
+	package = 'detection_ros2_node_hailo8'
+	plugin = 'DetectionNodeHailo8'
+	namespace = ''
+
+	config_filename = 'config.yaml'
+	config_filename_default = 'config_default.yaml'
+
+	config_dir = os.path.join(get_package_share_directory(package), 'config')
+	config = os.path.join(config_dir, config_filename_default)
+	if os.path.exists(os.path.join(config_dir, config_filename)):
+		config = os.path.join(config_dir, config_filename)
+		print("Load configuration from " + config_filename)
+	else:
+		print("Load default configuration")
+
+	camera_package = LaunchConfiguration('camera_package').perform(context)
+	camera_plugin = LaunchConfiguration('camera_plugin').perform(context)
+	camera_name = LaunchConfiguration('camera_name').perform(context)
+	camera_params = LaunchConfiguration('camera_params').perform(context)
+
+	nodes = []
+	if camera_package and camera_plugin:
+		nodes.append(
+			ComposableNode(
+				package = camera_package,
+				plugin = camera_plugin,
+				name = camera_name,
+				namespace = namespace,
+				parameters = [camera_params] if camera_params else [],
+				extra_arguments = [{'use_intra_process_comms': True}],
+			))
+
+	for name in ['object_det', 'gesture_det']:
+		nodes.append(
+			ComposableNode(
+				package = package,
+				plugin = plugin,
+				name = name,
+				namespace = namespace,
+				parameters = [config],
+				extra_arguments = [{'use_intra_process_comms': True}],
+			))
+
+	return [
+		ComposableNodeContainer(
+			name = 'detection_container',
+			namespace = namespace,
+			package = 'rclcpp_components',
+			executable = 'component_container_mt',
+			composable_node_descriptions = nodes,
+			output = 'screen',
+		),
+	]
+
+def generate_launch_description():
+
+	if not ((ROS_DISTRO == "foxy") or (ROS_DISTRO == "humble")):
+		return LaunchDescription()
+
+	return LaunchDescription([
+		DeclareLaunchArgument('camera_package', default_value = '', description = 'Package of the camera component'),
+		DeclareLaunchArgument('camera_plugin', default_value = '', description = 'Plugin name of the camera component'),
+		DeclareLaunchArgument('camera_name', default_value = 'camera', description = 'Node name of the camera component'),
+		DeclareLaunchArgument('camera_params', default_value = '', description = 'Parameter file of the camera component'),
+		OpaqueFunction(function = launch_setup),
+	])
@@ -2,59 +2,170 @@
 
 #include <hailo/hailort.hpp>
 #include "Timer.h"
-#include "YoloHailo.h"
 #include "hailomat.hpp"
 
-#include "SORT.h"
+#include "DetectionJson.h"
+#include "DetectionMsg.h"
+#include "HailoDetector.h"
+#include "MockDetector.h"
+
+#include <rclcpp_components/register_node_macro.hpp>
 
 #include <filesystem>
 #include <fstream>
-#include <future>
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <regex>
 
 const double ONE_SECOND            = 1000.0; // One second in milliseconds
+const float STATIC_TRACK_SPEED     = 0.002f; // Track velocity (normalized units per frame) up to which a track counts as static
 
 /**
  * @brief Contructor.
+ * Intra-process communication is enabled so that images from nodes in the same container are not copied.
  */
-DetectionNodeHailo8::DetectionNodeHailo8(const std::string &name) : Node(name, rclcpp::NodeOptions().use_intra_process_comms(false)) 
+DetectionNodeHailo8::DetectionNodeHailo8(const std::string &name, const rclcpp::NodeOptions &options) : Node(name, rclcpp::NodeOptions(options).use_intra_process_comms(true)) 
 {
 
 	this->declare_parameter("debug", false);
 	this->declare_parameter("topic", "");
+	// Several input topics served by one node, overrides topic. Every stream has its own trackers and output topics
+	this->declare_parameter("topics", std::vector<std::string>());
+	// Output topic suffixes of the streams, defaults to "stream<index>"
+	this->declare_parameter("stream_names", std::vector<std::string>());
+	// Time to wait for the frames of the other streams to infer them in one call, and the maximum frames per call (0: all streams)
+	this->declare_parameter("batch_window_ms", 2.0);
+	this->declare_parameter("batch_max_frames", 0);
 	this->declare_parameter("image_size", 640);
+	// Clockwise rotation of the input frames in degrees (0, 90, 180, 270)
+	this->declare_parameter("rotation", 0);
+	// Keep the aspect ratio and pad the borders of the network input, otherwise frames are stretched
+	this->declare_parameter("letterbox", true);
+	// Tiled inference of high-resolution frames: grid of overlapping tiles, optionally with the downscaled full frame
+	this->declare_parameter("tile_cols", 1);
+	this->declare_parameter("tile_rows", 1);
+	this->declare_parameter("tile_overlap", 0.2);
+	this->declare_parameter("tile_full_view", true);
+	// Intersection over the smaller box above which detections of different tiles are merged
+	this->declare_parameter("tile_merge_threshold", 0.5);
 	this->declare_parameter("print_detections", true);
 	this->declare_parameter("print_fps", true);
 	this->declare_parameter("det_topic", "test/det");
+	// Typed detections, defaults to det_topic + "Array"
+	this->declare_parameter("det_array_topic", "");
+	// JSON string outputs on det_topic and det_topic + "Stamped", kept for compatibility
+	this->declare_parameter("publish_json", true);
+	// Delta output on det_delta_topic (defaults to det_topic + "Delta") with added/updated/removed tracks
+	this->declare_parameter("publish_delta", false);
+	this->declare_parameter("det_delta_topic", "");
+	// Deliver the detection topics intra-process to subscribers in the same container, false: loaned or reused messages
+	this->declare_parameter("intra_process_outputs", false);
+	// Minimum change of a normalized box value that counts as update, 0 publishes every change
+	this->declare_parameter("delta_hysteresis", 0.0);
+	// Frames between two full snapshots, 0 disables them
+	this->declare_parameter("keyframe_interval", 30);
 	this->declare_parameter("fps_topic", "test/fps");
 	this->declare_parameter("DETECT_STR", "");
     this->declare_parameter("AMOUNT_STR", "");
     this->declare_parameter("FPS_STR", "");
 	this->declare_parameter("power_topic", "test/watt");
+	// Inference rate limit, frames above it are skipped before preprocessing, 0 disables the limit
 	this->declare_parameter("max_fps", 30.0f);
+	// Publish the Kalman-predicted tracks for frames skipped because of max_fps
+	this->declare_parameter("publish_predicted", false);
+	// Frames older than this (source stamp, or reception if unstamped) are dropped, 0 disables the deadline
+	this->declare_parameter("max_frame_age_ms", 0.0);
+	// Skip inference while the scene is static and no track moves, see README
+	this->declare_parameter("motion_gating", false);
+	this->declare_parameter("motion_sensitivity", 10.0);
+	this->declare_parameter("motion_area", 0.005);
+	this->declare_parameter("motion_refresh_interval", 15);
+	// Per-stage latency percentiles as diagnostic_msgs/DiagnosticArray, period in seconds, 0 disables them
+	this->declare_parameter("diagnostics_topic", "/diagnostics");
+	this->declare_parameter("diagnostics_period", 5.0);
 	this->declare_parameter("qos_sensor_data", true);
 	this->declare_parameter("qos_history_depth", 10);
 
 	
-	this->declare_parameter("deviceID", "0001:01:00.0"); 
+	// One or several accelerators, comma separated. Frames are spread over one inference worker per device
+	this->declare_parameter("deviceID", "0001:01:00.0");
+	// Worker selection for the next frame: "round_robin" or "least_loaded"
+	this->declare_parameter("device_scheduling", "least_loaded");
+	// Batches in flight per device, each with its own buffers: preprocessing and post-processing overlap the inference of the other ones
+	this->declare_parameter("frames_in_flight", 2);
     this->declare_parameter("CLASS_FILE", "");
     this->declare_parameter("YOLO_THRESHOLD", 0.3);	
 	this->declare_parameter("YOLOV7_HEF_FILE","/opt/dev/DL_Models/yolo_object/model/yolov7.hef");
 	this->declare_parameter("YOLO_Anchor", ""); //std::vector<std::vector<uint32_t>>
+	// Inference backend: "hailo" or "mock" (CPU only, synthetic or replayed detections)
+	this->declare_parameter("backend", "hailo");
+	this->declare_parameter("mock_latency_ms", 20.0);
+	this->declare_parameter("mock_jitter_ms", 0.0);
+	this->declare_parameter("mock_objects", 5);
+	this->declare_parameter("mock_seed", 0);
+	this->declare_parameter("mock_replay_file", "");
+	// Match detections to tracks of other classes, for detectors with flickering labels
+	this->declare_parameter("tracking_cross_class", false);
+	// Detections per frame the tracker buffers are reserved for, frames up to it do not allocate
+	this->declare_parameter("tracking_capacity", 100);
+	// Optional list of models sharing the input topic, each configured by parameters prefixed with "<model>."
+	this->declare_parameter("models", std::vector<std::string>());
 	
 
 	callback_handle_ = this->add_on_set_parameters_callback(std::bind(&DetectionNodeHailo8::parametersCallback, this, std::placeholders::_1));
 }
 
+/**
+ * @brief Component contructor, used when the node is loaded into a component container.
+ * The node name is set by the container, the node is initialized right away.
+ */
+DetectionNodeHailo8::DetectionNodeHailo8(const rclcpp::NodeOptions &options) : DetectionNodeHailo8("detection_node", options)
+{
+	init();
+}
+
+/**
+ * @brief Destructor, stops the pipeline stages.
+ */
+DetectionNodeHailo8::~DetectionNodeHailo8()
+{
+	if (m_frameBatcher) m_frameBatcher->Stop();
+	if (m_pool) m_pool->Stop();
+	if (m_inference) m_inference->Stop();
+
+	if (m_inferenceThread.joinable()) m_inferenceThread.join();
+	if (m_trackingThread.joinable()) m_trackingThread.join();
+}
+
 rcl_interfaces::msg::SetParametersResult DetectionNodeHailo8::parametersCallback(const std::vector<rclcpp::Parameter> &parameters)
 {
 
 	for (const auto &param: parameters){
 		if (param.get_name() == "max_fps")
-			m_maxFPS = param.as_double();
+		{
+			m_maxFPS = static_cast<float>(param.as_double());
+			for (auto &stream : m_streams)
+				stream->rateLimiter.SetRate(param.as_double());
+		}
+		else if (param.get_name() == "max_frame_age_ms")
+			m_maxFrameAgeMSec = param.as_double();
+		else if (param.get_name() == "motion_sensitivity")
+		{
+			for (auto &stream : m_streams)
+				stream->motionGate.SetSensitivity(static_cast<float>(param.as_double()));
+		}
+		else if (param.get_name() == "motion_area")
+		{
+			for (auto &stream : m_streams)
+				stream->motionGate.SetArea(static_cast<float>(param.as_double()));
+		}
+		else if (param.get_name() == "delta_hysteresis")
+			m_deltaHysteresis = static_cast<float>(param.as_double());
+		else if (param.get_name() == "keyframe_interval")
+			m_keyframeInterval = static_cast<uint32_t>(std::max<int64_t>(param.as_int(), 0));
 	}
 
 	rcl_interfaces::msg::SetParametersResult result;
@@ -63,6 +174,34 @@ rcl_interfaces::msg::SetParametersResult DetectionNodeHailo8::parametersCallback
 	return result;
 }
 
+/**
+ * @brief Output topic of a stream, the stream name is appended if there are several streams.
+ */
+std::string streamTopic(const std::string &topic, const std::string &stream)
+{
+	return stream.empty() ? topic : topic + "/" + stream;
+}
+
+/**
+ * @brief Split a comma separated list of device IDs, surrounding whitespace is removed.
+ */
+std::vector<std::string> parseDeviceList(const std::string &devices)
+{
+	std::vector<std::string> list;
+	std::stringstream stream(devices);
+	std::string device;
+
+	while (std::getline(stream, device, ','))
+	{
+		const std::size_t begin = device.find_first_not_of(" \t");
+		const std::size_t end   = device.find_last_not_of(" \t");
+		if (begin != std::string::npos)
+			list.push_back(device.substr(begin, end - begin + 1));
+	}
+
+	return list;
+}
+
 std::vector<std::vector<uint32_t>> parseAnchorsString(const std::string &anchors_string) {
     std::vector<std::vector<uint32_t>> anchors;
     std::regex outer_regex("\\{([^\\}]+)\\}");
@@ -91,59 +230,64 @@ std::vector<std::vector<uint32_t>> parseAnchorsString(const std::string &anchors
 void DetectionNodeHailo8::init() {
 
 
-	int qos_history_depth, image_size;
-	bool USE_FP16, YOLO_TINY, qos_sensor_data;
-	float YOLO_THRESHOLD;
-	std::string  DEVICEID, CLASS_FILE, YOLOV7_HEF_FILE, ros_topic, det_topic, fps_topic, power_topic, anchors_string ;
-	std::vector<std::vector<uint32_t>> anchors;
+	int qos_history_depth, keyframe_interval, motion_refresh_interval, tile_cols, tile_rows, batch_max_frames, frames_in_flight;
+	bool qos_sensor_data, tile_full_view;
+	double delta_hysteresis, motion_sensitivity, motion_area, diagnostics_period, max_frame_age_ms, tile_overlap, tile_merge_threshold, batch_window_ms;
+	std::string ros_topic, diagnostics_topic, device_scheduling;
+	std::vector<std::string> model_names, ros_topics, stream_names;
 
 	std::cout << "-- get ros config variables --" << std::endl;
 
 	// needed only for init
 	// get ros configuration
 	this->get_parameter("topic", ros_topic);
-	this->get_parameter("det_topic", det_topic);
-	this->get_parameter("fps_topic", fps_topic);
-	this->get_parameter("power_topic", power_topic);
-	this->get_parameter("image_size", image_size);
-	
-	// get Yolo configuration
-	this->get_parameter("deviceID", DEVICEID);
-    this->get_parameter("CLASS_FILE", CLASS_FILE);
-    this->get_parameter("YOLO_THRESHOLD", YOLO_THRESHOLD);
-	this->get_parameter("YOLOV7_HEF_FILE",YOLOV7_HEF_FILE);
-	this->get_parameter("YOLO_Anchor", anchors_string);
+	this->get_parameter("topics", ros_topics);
+	this->get_parameter("stream_names", stream_names);
+	this->get_parameter("batch_window_ms", batch_window_ms);
+	this->get_parameter("batch_max_frames", batch_max_frames);
+	this->get_parameter("models", model_names);
+	this->get_parameter("device_scheduling", device_scheduling);
+	this->get_parameter("frames_in_flight", frames_in_flight);
 
 	// some things needs to be member
-	this->get_parameter("max_fps", m_maxFPS);
-	this->get_parameter("DETECT_STR", m_DETECT_STR);
-    this->get_parameter("AMOUNT_STR", m_AMOUNT_STR);
-    this->get_parameter("FPS_STR", m_FPS_STR);
+	double max_fps;
+	this->get_parameter("max_fps", max_fps);
+	m_maxFPS = static_cast<float>(max_fps);
+	this->get_parameter("publish_predicted", m_publishPredicted);
+	this->get_parameter("max_frame_age_ms", max_frame_age_ms);
+	m_maxFrameAgeMSec = max_frame_age_ms;
+	this->get_parameter("rotation", m_image_rotation);
+	this->get_parameter("letterbox", m_letterbox);
+	m_image_rotation = (((m_image_rotation % 360) + 360) % 360) / 90 * 90;
+	this->get_parameter("tile_cols", tile_cols);
+	this->get_parameter("tile_rows", tile_rows);
+	this->get_parameter("tile_overlap", tile_overlap);
+	this->get_parameter("tile_full_view", tile_full_view);
+	this->get_parameter("tile_merge_threshold", tile_merge_threshold);
+
+	m_tileLayout         = TileLayout(static_cast<uint32_t>(std::max(tile_cols, 1)), static_cast<uint32_t>(std::max(tile_rows, 1)), static_cast<float>(tile_overlap), tile_full_view);
+	m_tileMergeThreshold = static_cast<float>(tile_merge_threshold);
+	if (m_tileLayout.IsTiled())
+		std::cout << "-- tiled inference " << m_tileLayout.GetName() << " --" << std::endl;
 	this->get_parameter("print_detections", m_print_detections);
+	this->get_parameter("intra_process_outputs", m_intraProcessOutputs);
 	this->get_parameter("print_fps", m_print_fps);
 	this->get_parameter("qos_sensor_data", qos_sensor_data);
 	this->get_parameter("qos_history_depth", qos_history_depth);
+	this->get_parameter("delta_hysteresis", delta_hysteresis);
+	this->get_parameter("keyframe_interval", keyframe_interval);
 
-	std::cout << "-- init hailo8 --" << std::endl;
-
-//	const AnchorVec { { 142, 110, 192, 243, 459, 401 }, { 36, 75, 76, 55, 72, 146 }, { 12, 16, 19, 36, 40, 28 } }
-
-	anchors = parseAnchorsString(anchors_string);
+	m_deltaHysteresis  = static_cast<float>(delta_hysteresis);
+	m_keyframeInterval = static_cast<uint32_t>(std::max(keyframe_interval, 0));
 
-	m_pYoloHailo8 = new YoloHailo(YOLOV7_HEF_FILE, CLASS_FILE,DEVICEID, YOLO_THRESHOLD, anchors);
-	m_pYoloHailo8->StartPowerMeasuring();
-
-	m_pSortTrackers = new SORT[m_pYoloHailo8->GetClassCount()];
-	////// Initialize SORT tracker for each class
-	for (std::size_t i = 0; i < m_pYoloHailo8->GetClassCount(); i++)
-		m_pSortTrackers[i] = SORT(30, 5);
-
-	m_lastTrackings.clear();
-
-	m_elapsedTime = 0;
-	m_timer.Start();
+	this->get_parameter("diagnostics_topic", diagnostics_topic);
+	this->get_parameter("diagnostics_period", diagnostics_period);
+	this->get_parameter("motion_gating", m_motionGating);
+	this->get_parameter("motion_sensitivity", motion_sensitivity);
+	this->get_parameter("motion_area", motion_area);
+	this->get_parameter("motion_refresh_interval", motion_refresh_interval);
 
-	std::cout << "-- subscribe to : " << ros_topic <<  " --" << std::endl;
+	m_motionRefreshInterval = static_cast<uint32_t>(std::max(motion_refresh_interval, 0));
 
 	if(qos_sensor_data){
 		std::cout << "using ROS2 qos_sensor_data" << std::endl;
@@ -152,7 +296,9 @@ void DetectionNodeHailo8::init() {
 
 	m_qos_profile = m_qos_profile.keep_last(qos_history_depth);
 	//m_qos_profile = m_qos_profile.lifespan(std::chrono::milliseconds(500));
-	m_qos_profile = m_qos_profile.reliability(RMW_QOS_POLICY_RELIABILITY_RELIABLE);
+	// Sensor data QoS stays best effort, retransmitting old frames only adds latency
+	if (!qos_sensor_data)
+		m_qos_profile = m_qos_profile.reliability(RMW_QOS_POLICY_RELIABILITY_RELIABLE);
 	//m_qos_profile = m_qos_profile.durability(RMW_QOS_POLICY_DURABILITY_VOLATILE);
 	//m_qos_profile = m_qos_profile.durability(RMW_QOS_POLICY_DURABILITY_TRANSIENT_LOCAL);
 	
@@ -161,192 +307,707 @@ void DetectionNodeHailo8::init() {
 	m_qos_profile_sysdef = m_qos_profile_sysdef.reliability(RMW_QOS_POLICY_RELIABILITY_RELIABLE);
 	//m_qos_profile_sysdef = m_qos_profile_sysdef.durability(RMW_QOS_POLICY_DURABILITY_VOLATILE);
 	//m_qos_profile_sysdef = m_qos_profile_sysdef.durability(RMW_QOS_POLICY_DURABILITY_TRANSIENT_LOCAL);
-	
-	m_image_small_subscription = this->create_subscription<sensor_msgs::msg::Image>( ros_topic, m_qos_profile, std::bind(&DetectionNodeHailo8::imageSmallCallback, this, std::placeholders::_1));
+
+	// Without a topic list the node serves the single topic with unchanged output topics
+	if (ros_topics.empty())
+		ros_topics.push_back(ros_topic);
+
+	for (std::size_t i = 0; i < ros_topics.size(); i++)
+	{
+		m_streams.push_back(std::make_unique<StreamContext>());
+		StreamContext &stream = *m_streams.back();
+
+		if (i < stream_names.size())
+			stream.name = stream_names[i];
+		else if (ros_topics.size() > 1)
+			stream.name = "stream" + std::to_string(i);
+
+		stream.rateLimiter.SetRate(m_maxFPS);
+		stream.motionGate.SetSensitivity(static_cast<float>(motion_sensitivity));
+		stream.motionGate.SetArea(static_cast<float>(motion_area));
+	}
+
+	// Without a model list the top level parameters describe the only model
+	if (model_names.empty())
+		model_names.push_back("");
+
+	for (const std::string &model_name : model_names)
+	{
+		m_networks.push_back(std::make_unique<NetworkContext>());
+		m_networks.back()->name = model_name;
+		initModel(*m_networks.back(), model_name.empty() ? "" : model_name + ".");
+
+		// Every worker runs all models, one device of every model each
+		if (m_networks.back()->detectors.size() != m_networks.front()->detectors.size())
+			throw std::runtime_error("DetectionNodeHailo8: all models need the same number of devices in deviceID");
+	}
+
+	const std::size_t devices = m_networks.front()->detectors.size();
+	m_inference = std::make_unique<InferenceStage>(m_networks, m_streams.size(), static_cast<std::size_t>(std::max(frames_in_flight, 1)), m_tileLayout,
+												   m_letterbox, static_cast<uint32_t>(m_image_rotation), m_tileMergeThreshold, m_latency);
+
+	if (m_inference->GetWorkerCount() > 1)
+		std::cout << "-- " << m_inference->GetWorkerCount() << " inference workers on " << devices << " device(s), " << device_scheduling << " --" << std::endl;
+
+	const auto scheduling = (device_scheduling == "round_robin") ? InferencePool<InferenceBatch>::Scheduling::ROUND_ROBIN : InferencePool<InferenceBatch>::Scheduling::LEAST_LOADED;
+	m_pool = std::make_unique<InferencePool<InferenceBatch>>(m_inference->GetWorkerCount(), scheduling,
+		[this](const std::size_t &w, InferenceBatch &batch) { m_inference->Process(w, batch); },
+		[this](InferenceBatch &batch) { deliverBatch(batch); });
+
+	m_batchWindow    = std::chrono::microseconds(static_cast<int64_t>(std::max(batch_window_ms, 0.0) * 1000.0));
+	m_frameBatcher   = std::make_unique<FrameBatcher<FrameJob>>(m_streams.size(), static_cast<std::size_t>(std::max(batch_max_frames, 0)));
+
+	// Telemetry and parameter updates run in their own callback groups, a multi-threaded executor never delays the frames for them
+	m_imageGroup     = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+	m_telemetryGroup = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+
+	if (diagnostics_period > 0.0)
+	{
+		m_diagnostics_publisher = this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(diagnostics_topic, m_qos_profile_sysdef);
+		m_diagnostics_timer     = this->create_wall_timer(std::chrono::duration<double>(diagnostics_period), std::bind(&DetectionNodeHailo8::publishDiagnostics, this), m_telemetryGroup);
+	}
+
+	m_timer.Start();
+	m_fps_timer = this->create_wall_timer(std::chrono::duration<double, std::milli>(ONE_SECOND), std::bind(&DetectionNodeHailo8::publishFPS, this), m_telemetryGroup);
+
+	std::cout << "-- start pipeline stages --" << std::endl;
+
+	m_inferenceThread = std::thread(&DetectionNodeHailo8::inferenceLoop, this);
+	m_trackingThread  = std::thread(&DetectionNodeHailo8::trackingLoop, this);
+
+	for (std::size_t i = 0; i < m_streams.size(); i++)
+	{
+		std::cout << "-- subscribe to : " << ros_topics[i] <<  " --" << std::endl;
+
+		rclcpp::SubscriptionOptions options;
+		options.callback_group = m_imageGroup;
+
+		m_streams[i]->subscription = this->create_subscription<sensor_msgs::msg::Image>(ros_topics[i], m_qos_profile, std::bind(&DetectionNodeHailo8::imageSmallCallback, this, std::placeholders::_1, i), options);
+	}
 	//cv::namedWindow(m_window_name_image_small, cv::WINDOW_AUTOSIZE);
 
+	std::cout << "+==========[ init done ]==========+" << std::endl;
+}
+
+/**
+ * @brief Initialize one hosted model: Hailo8 network, and per stream the SORT tracker and output topics.
+ * @param network Model to initialize
+ * @param prefix Parameter prefix of the model, the top level parameters are used as defaults
+ */
+void DetectionNodeHailo8::initModel(NetworkContext &network, const std::string &prefix)
+{
+	int image_size, mock_objects, mock_seed, tracking_capacity;
+	float YOLO_THRESHOLD;
+	bool tracking_cross_class, publish_json, publish_delta;
+	std::string DETECT_STR, AMOUNT_STR, FPS_STR;
+	double mock_latency_ms, mock_jitter_ms;
+	std::string DEVICEID, CLASS_FILE, YOLOV7_HEF_FILE, det_topic, det_array_topic, det_delta_topic, fps_topic, power_topic, anchors_string, backend, mock_replay_file;
+	std::vector<std::vector<uint32_t>> anchors;
+
+	auto getModelParameter = [this, &prefix](const std::string &key, auto &value) {
+		this->get_parameter(key, value);
+		if (!prefix.empty())
+			value = this->declare_parameter(prefix + key, value);
+	};
+
+	getModelParameter("det_topic", det_topic);
+	getModelParameter("det_array_topic", det_array_topic);
+	getModelParameter("publish_json", publish_json);
+	getModelParameter("publish_delta", publish_delta);
+	getModelParameter("det_delta_topic", det_delta_topic);
+	getModelParameter("fps_topic", fps_topic);
+	getModelParameter("power_topic", power_topic);
+	getModelParameter("image_size", image_size);
+	getModelParameter("DETECT_STR", DETECT_STR);
+	getModelParameter("AMOUNT_STR", AMOUNT_STR);
+	getModelParameter("FPS_STR", FPS_STR);
+
+	// get Yolo configuration
+	getModelParameter("deviceID", DEVICEID);
+	getModelParameter("CLASS_FILE", CLASS_FILE);
+	getModelParameter("YOLO_THRESHOLD", YOLO_THRESHOLD);
+	getModelParameter("YOLOV7_HEF_FILE", YOLOV7_HEF_FILE);
+	getModelParameter("YOLO_Anchor", anchors_string);
+	getModelParameter("backend", backend);
+	getModelParameter("mock_latency_ms", mock_latency_ms);
+	getModelParameter("mock_jitter_ms", mock_jitter_ms);
+	getModelParameter("mock_objects", mock_objects);
+	getModelParameter("mock_seed", mock_seed);
+	getModelParameter("mock_replay_file", mock_replay_file);
+	getModelParameter("tracking_cross_class", tracking_cross_class);
+	getModelParameter("tracking_capacity", tracking_capacity);
+
+	network.imageSize = image_size;
+	network.devices   = parseDeviceList(DEVICEID);
+	if (network.devices.empty())
+		network.devices.push_back(DEVICEID);
+
+	// Mock instances of a worker pool present one continuous scene
+	const auto mockFrameCounter = std::make_shared<std::atomic<uint64_t>>(0);
+
+	for (const std::string &device : network.devices)
+	{
+		if (backend == "mock")
+		{
+			std::cout << "-- init mock detector " << network.name << " (" << device << ") --" << std::endl;
+
+			network.detectors.push_back(std::make_unique<MockDetector>(CLASS_FILE, mock_latency_ms, mock_jitter_ms, static_cast<uint32_t>(mock_objects), static_cast<uint32_t>(mock_seed), mock_replay_file, mockFrameCounter));
+		}
+		else
+		{
+			std::cout << "-- init hailo8 " << network.name << " (" << device << ") --" << std::endl;
+
+//			const AnchorVec { { 142, 110, 192, 243, 459, 401 }, { 36, 75, 76, 55, 72, 146 }, { 12, 16, 19, 36, 40, 28 } }
+
+			anchors = parseAnchorsString(anchors_string);
+
+			network.detectors.push_back(std::make_unique<HailoDetector>(YOLOV7_HEF_FILE, CLASS_FILE, device, YOLO_THRESHOLD, anchors));
+		}
+
+		network.detectors.back()->StartPowerMeasuring();
+		network.stages.push_back(std::make_unique<NetworkContext::DeviceStage>());
+	}
+
+	network.classNames        = network.detectors.front()->GetClassNames();
+	network.detectionCapacity = static_cast<std::size_t>(std::max(tracking_capacity, 0));
+
 	std::cout << "-- create topics for publishing --" << std::endl;
 
-	m_detection_publisher   		= this->create_publisher<std_msgs::msg::String>(det_topic, m_qos_profile_sysdef);
-	m_detectionStamped_publisher 	= this->create_publisher<sm_interfaces::msg::StringStamped>(det_topic + "Stamped", m_qos_profile_sysdef);
-	m_fps_publisher    				= this->create_publisher<std_msgs::msg::String>(fps_topic, m_qos_profile_sysdef);
-	m_power_publisher    			= this->create_publisher<std_msgs::msg::String>(power_topic, m_qos_profile_sysdef);
+	if (det_array_topic.empty())
+		det_array_topic = det_topic + "Array";
+	if (det_delta_topic.empty())
+		det_delta_topic = det_topic + "Delta";
 
-	std::cout << "+==========[ init done ]==========+" << std::endl;
+	// Only the images need zero-copy intra-process delivery, the small outputs avoid an allocation per message
+	rclcpp::PublisherOptions outputOptions;
+	outputOptions.use_intra_process_comm = m_intraProcessOutputs ? rclcpp::IntraProcessSetting::Enable : rclcpp::IntraProcessSetting::Disable;
+
+	for (auto &stream : m_streams)
+	{
+		stream->models.push_back(std::make_unique<ModelContext>());
+		ModelContext &model = *stream->models.back();
+
+		model.network      = &network;
+		model.AMOUNT_STR   = AMOUNT_STR;
+		model.FPS_STR      = FPS_STR;
+		model.publishJson  = publish_json;
+		model.publishDelta = publish_delta;
+
+		////// Initialize SORT tracker, one for all classes, and the buffers of the frame path
+		model.tracks = std::make_unique<ModelTracks>(network, tracking_cross_class, DETECT_STR, AMOUNT_STR, m_latency);
+
+		ReserveDetectionArray(model.arrayMessage.GetReused(), model.tracks->GetTrackCapacity());
+		ReserveDetectionDelta(model.deltaMessage.GetReused(), model.tracks->GetTrackCapacity());
+
+		// The serialized JSON alternates between the two string messages, both get the full size
+		const std::size_t jsonCapacity = model.tracks->GetJsonCapacity();
+		model.jsonBuffer.reserve(jsonCapacity);
+		model.jsonMessage.GetReused().data.reserve(jsonCapacity);
+		model.jsonStampedMessage.GetReused().data.reserve(jsonCapacity);
+
+		model.arrayMessage.SetIntraProcess(m_intraProcessOutputs);
+		model.deltaMessage.SetIntraProcess(m_intraProcessOutputs);
+		model.jsonMessage.SetIntraProcess(m_intraProcessOutputs);
+		model.jsonStampedMessage.SetIntraProcess(m_intraProcessOutputs);
+
+		const std::string &name = stream->name;
+
+		model.detectionArray_publisher 		= this->create_publisher<detection_interfaces::msg::DetectionArray>(streamTopic(det_array_topic, name), m_qos_profile_sysdef, outputOptions);
+		if (model.publishJson)
+		{
+			model.detection_publisher   		= this->create_publisher<std_msgs::msg::String>(streamTopic(det_topic, name), m_qos_profile_sysdef, outputOptions);
+			model.detectionStamped_publisher 	= this->create_publisher<sm_interfaces::msg::StringStamped>(streamTopic(det_topic + "Stamped", name), m_qos_profile_sysdef, outputOptions);
+		}
+		if (model.publishDelta)
+			model.detectionDelta_publisher 	= this->create_publisher<detection_interfaces::msg::DetectionDelta>(streamTopic(det_delta_topic, name), m_qos_profile_sysdef, outputOptions);
+		model.fps_publisher    				= this->create_publisher<std_msgs::msg::String>(streamTopic(fps_topic, name), m_qos_profile_sysdef);
+		model.power_publisher    			= this->create_publisher<std_msgs::msg::String>(streamTopic(power_topic, name), m_qos_profile_sysdef);
+	}
 }
 
 
 /**
  * @brief Callback function for reveived image message.
+ * Only hands the message over to the inference stage, older pending frames of the same stream are dropped.
  * @param img_msg Received image message
+ * @param stream Index of the input stream
  */
-void DetectionNodeHailo8::imageSmallCallback(sensor_msgs::msg::Image::SharedPtr img_msg) {
+void DetectionNodeHailo8::imageSmallCallback(sensor_msgs::msg::Image::ConstSharedPtr img_msg, const std::size_t stream) {
 
-	cv::Size image_size(static_cast<int>(img_msg->width), static_cast<int>(img_msg->height));
-	cv::Mat color_image(image_size, CV_8UC3, (void *)img_msg->data.data(), cv::Mat::AUTO_STEP);
+	// Transport latency, only meaningful if the publisher stamps the images with the same clock
+	const rclcpp::Time stamp(img_msg->header.stamp, this->get_clock()->get_clock_type());
+	if (stamp.nanoseconds() > 0)
+		m_latency[STAGE_RECEIVE].Record(std::chrono::nanoseconds((this->now() - stamp).nanoseconds()));
 
-	ProcessNextFrame(color_image);
-	ProcessDetections();
-	
-	m_frameCnt++;
-	CheckFPS(&m_frameCnt);
+	const time_point received = hires_clock::now();
+	if (isStale(img_msg->header, received))
+		return;
+
+	m_frameBatcher->Push(stream, { std::move(img_msg), received });
 }
 
-void DetectionNodeHailo8::ProcessDetections( )
+/**
+ * @brief Check the frame against the age deadline, stale frames are counted.
+ * The age is taken from the source stamp, unstamped frames use the time since reception.
+ * @return True if the frame is older than max_frame_age_ms
+ */
+bool DetectionNodeHailo8::isStale(const std_msgs::msg::Header &header, const time_point &received)
 {
-	bool changed                        = false;
-	//const ::YoloResults& results = m_yoloResults;
+	const double maxAge = m_maxFrameAgeMSec;
+	if (maxAge <= 0.0)
+		return false;
 
-	std::map<uint32_t, TrackingObjects> trackingDets;
+	const rclcpp::Time stamp(header.stamp, this->get_clock()->get_clock_type());
+	const double age = (stamp.nanoseconds() > 0) ? (this->now() - stamp).seconds() * ONE_SECOND
+												  : std::chrono::duration<double, std::milli>(hires_clock::now() - received).count();
 
-	for (const YoloHailo::YoloResult& res : m_yoloHailoResults)
-	{
-		uint32_t id  = res.classID - 1;
-		float x      = res.x;
-		float y      = res.y;
-		float width  = res.w;
-		float height = res.h;
-
-		if (x < 0.0f) x = 0.0f;
-		if (y < 0.0f) y = 0.0f;
-		if (width > 1.0f) width = 1.0f;
-		if (height > 1.0f) height = 1.0f;
-
-		trackingDets.try_emplace(id, TrackingObjects());
-		trackingDets[id].push_back({ { x ,y , width, height }, static_cast<uint32_t>(std::round(res.classProb * 100)), res.label});
-	}
+	if (age <= maxAge)
+		return false;
 
-	TrackingObjects trackers;
-	TrackingObjects dets;
+	m_staleFrames++;
+	return true;
+}
 
-	for (std::size_t i = 0; i < m_pYoloHailo8->GetClassCount(); i++)
-	{
-		if (trackingDets.count(i))
-			dets = trackingDets[i];
-		else
-			dets = TrackingObjects();
-			TrackingObjects t = m_pSortTrackers[i].Update(dets);
-		trackers.insert(std::end(trackers), std::begin(t), std::end(t));
-	}
+/**
+ * @brief Dispatching stage, always processes the newest available frame of every stream.
+ * Frames of different streams arriving within the batch window are inferred together, the batches
+ * are spread over the inference workers. A batch is only taken once a worker is free, until then
+ * newer frames replace the pending ones.
+ */
+void DetectionNodeHailo8::inferenceLoop()
+{
+	std::vector<std::pair<std::size_t, FrameJob>> frames;
 
-	if (trackers.size() != m_lastTrackings.size())
-		changed = true;
-	else
+	while (m_pool->WaitForWorker() && m_frameBatcher->PopBatch(frames, m_batchWindow))
 	{
-		for (const auto& [idx, obj] : enumerate(trackers))
+		InferenceBatch batch = m_inference->AcquireBatch();
+		bool infer           = false;
+
+		for (auto &[index, frame] : frames)
 		{
-			if (m_lastTrackings[idx] != obj)
+			StreamContext &stream = *m_streams[index];
+
+			Preprocessor::Encoding encoding;
+			if (!Preprocessor::ParseEncoding(frame.msg->encoding, encoding))
 			{
-				changed = true;
-				break;
+				RCLCPP_ERROR_ONCE(this->get_logger(), "unsupported image encoding '%s', frames are skipped", frame.msg->encoding.c_str());
+				continue;
+			}
+
+			const Preprocessor::Frame raw = { frame.msg->data.data(), frame.msg->width, frame.msg->height, frame.msg->step, encoding };
+			if (frame.msg->data.size() < Preprocessor::GetRequiredBytes(raw))
+			{
+				RCLCPP_ERROR_ONCE(this->get_logger(), "image data smaller than its size and step, frames are skipped");
+				continue;
+			}
+
+			if (Preprocessor::HasPairedChroma(encoding) && (raw.width & 1))
+			{
+				RCLCPP_ERROR_ONCE(this->get_logger(), "odd image width for encoding '%s', frames are skipped", frame.msg->encoding.c_str());
+				continue;
 			}
-		}
-	}
 
-	if (changed || (m_framesSincePublish > 30)){
-		printDetections(trackers);
-		m_framesSincePublish = 0;
+			// Detections are reported relative to the rotated frame
+			const bool swapped = (m_image_rotation == 90 || m_image_rotation == 270);
+
+			DetectionJob job;
+			job.stream       = index;
+			job.received     = frame.received;
+			job.frame.header = frame.msg->header;
+			job.frame.width  = swapped ? frame.msg->height : frame.msg->width;
+			job.frame.height = swapped ? frame.msg->width : frame.msg->height;
+
+			// Frames that aged past the deadline while waiting are not inferred
+			if (isStale(job.frame.header, job.received))
+				continue;
+
+			// Frames above max_fps are skipped before any conversion or inference
+			bool skip = !stream.rateLimiter.TryAcquire(frame.received);
+			if (skip)
+				m_skippedFrames++;
+			else if (m_motionGating)
+			{
+				// Static scene without moving tracks, the current tracks stay valid until the forced refresh
+				const bool motion = stream.motionGate.HasMotion(raw.data, raw.width, raw.height, raw.step, Preprocessor::GetBytesPerPixel(encoding));
+				skip              = !motion && !stream.tracksMoving && stream.framesSinceInference < m_motionRefreshInterval;
+
+				if (skip)
+				{
+					stream.framesSinceInference++;
+					stream.motionSkippedFrames++;
+				}
+				else
+				{
+					stream.motionGate.Accept();
+					stream.framesSinceInference = 0;
+				}
+			}
+
+			if (skip)
+			{
+				frame.msg.reset();
+
+				// Delivered in order with the inferred frames, the tracks are only extrapolated
+				if (m_publishPredicted)
+				{
+					job.predicted = true;
+					batch.push_back({ nullptr, encoding, std::move(job) });
+				}
+				continue;
+			}
+
+			const auto queueAge = hires_clock::now() - frame.received;
+			m_latency[STAGE_QUEUE].Record(queueAge);
+			m_queueAgeMSec = std::chrono::duration<double, std::milli>(queueAge).count();
+
+			batch.push_back({ std::move(frame.msg), encoding, std::move(job) });
+			infer = true;
+		}
 
+		if (!batch.empty())
+			m_pool->Submit(std::move(batch), infer);
+		else
+			m_inference->ReleaseBatch(std::move(batch));
 	}
-	m_framesSincePublish++;
 }
 
-void DetectionNodeHailo8::ProcessNextFrame(cv::Mat &img)
+/**
+ * @brief Hand the results of a batch to the tracking stage, called in dispatch order.
+ */
+void DetectionNodeHailo8::deliverBatch(InferenceBatch &batch)
 {
-	if (!img.empty()){
-		m_yoloHailoResults = m_pYoloHailo8->Infer(img);
-	}
-} 
+	// Rather skip the frame than publish detections that are already too old
+	auto stale = [this](const DetectionJob &job) { return isStale(job.frame.header, job.received); };
 
-BBox DetectionNodeHailo8::toCenter(const BBox& bBox)
-{
-	// x_y = center
-	float h = bBox.height;
-	float w = bBox.width;
-	float x = bBox.x + (w / 2);
-	float y = bBox.y + (h / 2);
-	return BBox(x, y, w, h);
+	if (m_inference->Deliver(batch, stale) > 0)
+		RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 5000, "tracking stage falls behind, inferred frames are dropped");
 }
 
-void DetectionNodeHailo8::printDetections(const TrackingObjects& trackers)
+/**
+ * @brief Tracking and publishing stage, runs concurrently to the inference of the next frames.
+ */
+void DetectionNodeHailo8::trackingLoop()
 {
-	std::stringstream str("");
-	str << string_format("{\"%s\": [", m_DETECT_STR.c_str());
+	DetectionJob job;
+	time_point lastFrame;
 
-	for (const auto& [i, t] : enumerate(trackers))
+	while (m_inference->Pop(job))
 	{
-		BBox centerBox = toCenter(t.bBox);
-		str << string_format("{\"TrackID\": %i, \"name\": \"%s\", \"center\": [%.3f,%.3f], \"w_h\": [%.3f,%.3f]}", t.trackingID, t.name.c_str(), roundf(centerBox.x*1000.0f)/1000.0f , roundf(centerBox.y*1000.0f)/1000.0f, roundf(centerBox.width*1000.0f)/1000.0f, roundf(centerBox.height*1000.0f)/1000.0f);
-		// Prevent a trailing ',' for the last element
-		if (i + 1 < trackers.size()) str << ", ";
+		StreamContext &stream = *m_streams[job.stream];
+
+		if (job.predicted)
+		{
+			// Fraction of the inference interval that has passed since the last inferred frame
+			const double sinceInference = std::chrono::duration<double, std::milli>(job.received - stream.lastInferenceTime).count();
+			const float frames          = (stream.inferenceIntervalMSec > 0.0) ? static_cast<float>(std::clamp(sinceInference / stream.inferenceIntervalMSec, 0.0, 2.0)) : 0.0f;
+
+			for (auto &model : stream.models)
+				ProcessPrediction(*model, job.frame, frames);
+			continue;
+		}
+
+		if (stream.lastInferenceTime != time_point())
+			stream.inferenceIntervalMSec = std::chrono::duration<double, std::milli>(job.received - stream.lastInferenceTime).count();
+		stream.lastInferenceTime = job.received;
+
+		for (std::size_t i = 0; i < stream.models.size(); i++)
+			ProcessDetections(*stream.models[i], job.results[i], job.frame);
+
+		m_inference->Release(job);
+
+		if (m_motionGating)
+		{
+			bool moving = false;
+			for (const auto &model : stream.models)
+				moving |= !model->tracks->IsStatic(STATIC_TRACK_SPEED);
+			stream.tracksMoving = moving;
+		}
+
+		// Only counted here, the FPS report runs on the telemetry timer
+		const time_point now = hires_clock::now();
+		if (lastFrame != time_point())
+			m_frameIntervalMSec = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+		lastFrame = now;
+
+		stream.frameCnt++;
 	}
+}
 
-	m_lastTrackings = trackers;
+/**
+ * @brief Track the detections of one model and publish the tracks if they changed.
+ */
+void DetectionNodeHailo8::ProcessDetections(ModelContext &model, const Detections &results, const FrameInfo &frame)
+{
+	if (const TrackDelta::Events *events = model.tracks->Update(results, m_deltaHysteresis, m_keyframeInterval))
+		publishTracks(model, *events, frame);
+}
 
-	str << string_format("], \"%s\": %llu }", m_AMOUNT_STR.c_str(), m_lastTrackings.size());
+/**
+ * @brief Publish the tracks of one model extrapolated to a frame that has not been inferred.
+ * @param frames Time since the last inferred frame in inference intervals
+ */
+void DetectionNodeHailo8::ProcessPrediction(ModelContext &model, const FrameInfo &frame, const float frames)
+{
+	if (const TrackDelta::Events *events = model.tracks->Extrapolate(frames, m_deltaHysteresis, m_keyframeInterval))
+		publishTracks(model, *events, frame);
+}
 
-	auto message = std_msgs::msg::String();
-	message.data = str.str();
+/**
+ * @brief Publish the tracks of one model, called only if a track appeared, vanished or moved past the hysteresis, or a keyframe is due.
+ */
+void DetectionNodeHailo8::publishTracks(ModelContext &model, const TrackDelta::Events &events, const FrameInfo &frame)
+{
+	printDetections(model, frame);
 
-	auto messageStamped = sm_interfaces::msg::StringStamped();
-	messageStamped.data = str.str();
-	messageStamped.header.stamp    = this->get_clock()->now();
+	if (model.publishDelta)
+		publishDelta(model, events, frame);
+}
 
+/**
+ * @brief Publish the tracked objects of one model.
+ * The typed detection array is the primary output, the JSON string topics are optional.
+ */
+void DetectionNodeHailo8::printDetections(ModelContext &model, const FrameInfo &frame)
+{
 	try{
-		m_detection_publisher->publish(message);
-		m_detectionStamped_publisher->publish(messageStamped);
+		{
+			ScopedLatency latency(m_latency[STAGE_SERIALIZE]);
+			model.tracks->FillArray(model.arrayMessage.Borrow(*model.detectionArray_publisher), frame);
+		}
+
+		ScopedLatency latency(m_latency[STAGE_PUBLISH]);
+		model.arrayMessage.Publish(*model.detectionArray_publisher);
 	}
 	catch (...) {
 		RCLCPP_INFO(this->get_logger(), "hmm publishing dets has failed!! ");
 	}
 
-	if (m_print_detections)
-		RCLCPP_INFO(this->get_logger(), "Publishing: '%s'", message.data.c_str());
+	if (!model.publishJson && !m_print_detections)
+		return;
+
+	try{
+		// Serialize directly into the outgoing stamped message, without JSON topics into the reused print buffer
+		sm_interfaces::msg::StringStamped *messageStamped = model.publishJson ? &model.jsonStampedMessage.Borrow(*model.detectionStamped_publisher) : nullptr;
+		std::string &json                                 = messageStamped ? messageStamped->data : model.jsonBuffer;
+		{
+			ScopedLatency latency(m_latency[STAGE_SERIALIZE]);
+			model.tracks->WriteJson(json);
+		}
+
+		if (m_print_detections)
+			RCLCPP_INFO(this->get_logger(), "Publishing: '%s'", json.c_str());
+
+		if (!messageStamped)
+			return;
+
+		messageStamped->header = frame.header; // Source stamp and frame_id, consumers can align the detections to the image
+
+		std_msgs::msg::String &message = model.jsonMessage.Borrow(*model.detection_publisher);
+
+		ScopedLatency latency(m_latency[STAGE_PUBLISH]);
+		if (model.jsonStampedMessage.KeepsMessage())
+		{
+			// The published stamped message is still ours, its buffer moves on to the plain message and the old one comes back
+			model.jsonStampedMessage.Publish(*model.detectionStamped_publisher);
+			message.data.swap(json);
+			model.jsonMessage.Publish(*model.detection_publisher);
+		}
+		else
+		{
+			// Intra-process or loaned messages are handed over, both need their own copy
+			message.data = json;
+			model.jsonMessage.Publish(*model.detection_publisher);
+			model.jsonStampedMessage.Publish(*model.detectionStamped_publisher);
+		}
+	}
+	catch (...) {
+		RCLCPP_INFO(this->get_logger(), "hmm publishing dets has failed!! ");
+	}
 	
 }
 
-void DetectionNodeHailo8::CheckFPS(uint64_t* pFrameCnt)
+/**
+ * @brief Publish the changes of the tracked objects of one model since the last published state.
+ */
+void DetectionNodeHailo8::publishDelta(ModelContext &model, const TrackDelta::Events &events, const FrameInfo &frame)
+{
+	try{
+		{
+			ScopedLatency latency(m_latency[STAGE_SERIALIZE]);
+			model.tracks->FillDelta(model.deltaMessage.Borrow(*model.detectionDelta_publisher), frame, events);
+		}
+
+		ScopedLatency latency(m_latency[STAGE_PUBLISH]);
+		model.deltaMessage.Publish(*model.detectionDelta_publisher);
+	}
+	catch (...) {
+		RCLCPP_INFO(this->get_logger(), "hmm publishing dets has failed!! ");
+	}
+}
+
+/**
+ * @brief Publish the latency percentiles of every stage since the last call and reset the histograms.
+ * Stages without samples in the period are reported with level STALE.
+ */
+void DetectionNodeHailo8::publishDiagnostics()
+{
+	static const std::array<const char *, STAGE_COUNT> STAGE_NAMES = { "receive", "queue", "preprocess", "infer", "merge", "group", "track", "serialize", "publish" };
+
+	diagnostic_msgs::msg::DiagnosticArray message;
+	message.header.stamp = this->now();
+
+	for (std::size_t stage = 0; stage < STAGE_COUNT; stage++)
 	{
-		m_timer.Stop();
+		const LatencyHistogram::Summary summary = m_latency[stage].Snapshot();
+
+		diagnostic_msgs::msg::DiagnosticStatus status;
+		status.name        = std::string(this->get_name()) + ": latency " + STAGE_NAMES[stage];
+		status.hardware_id = this->get_fully_qualified_name();
 
-		double minFrameTime = 1000.0 / m_maxFPS;
-		double itrTime      = m_timer.GetElapsedTimeInMilliSec();
-		double fps;
+		if (summary.count == 0)
+		{
+			status.level   = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+			status.message = "no samples";
+		}
+		else
+		{
+			status.level   = diagnostic_msgs::msg::DiagnosticStatus::OK;
+			status.message = string_format("p99 %.3f ms", summary.p99);
+		}
 
-		m_elapsedTime += itrTime;
+		const std::array<std::pair<const char *, double>, 4> values = { { { "p50_ms", summary.p50 }, { "p90_ms", summary.p90 }, { "p99_ms", summary.p99 }, { "max_ms", summary.max } } };
 
-		fps = 1000 / (m_elapsedTime / (*pFrameCnt));
+		diagnostic_msgs::msg::KeyValue count;
+		count.key   = "count";
+		count.value = std::to_string(summary.count);
+		status.values.push_back(count);
 
-		if (m_elapsedTime >= ONE_SECOND)
+		for (const auto &[key, value] : values)
 		{
-			PrintFPS(fps, itrTime);
+			diagnostic_msgs::msg::KeyValue keyValue;
+			keyValue.key   = key;
+			keyValue.value = string_format("%.3f", value);
+			status.values.push_back(keyValue);
+		}
 
-			*pFrameCnt    = 0;
-			m_elapsedTime = 0;
+		// Latencies depend on the tile layout, reported along to compare layouts
+		if (stage == STAGE_INFER && m_tileLayout.IsTiled())
+		{
+			diagnostic_msgs::msg::KeyValue tiling;
+			tiling.key   = "tiling";
+			tiling.value = m_tileLayout.GetName();
+			status.values.push_back(tiling);
 		}
 
-		m_timer.Start();
+		message.status.push_back(status);
+	}
+
+	try{
+		m_diagnostics_publisher->publish(message);
 	}
+	catch (...) {
+		RCLCPP_INFO(this->get_logger(), "m_diagnostics_publisher: hmm publishing diagnostics has failed!! ");
+	}
+}
 
-void DetectionNodeHailo8::PrintFPS(const float fps, const float itrTime)
+/**
+ * @brief Publish the frame rate and power of every model, called by the telemetry timer once per second.
+ * Reads counters of the pipeline, only the power query takes the device lock of the inference workers.
+ */
+void DetectionNodeHailo8::publishFPS()
 {
-		
-	std::stringstream str("");
+	m_timer.Stop();
+	const double elapsedTime = m_timer.GetElapsedTimeInMilliSec();
+	m_timer.Start();
+
+	if (elapsedTime <= 0.0) return;
+
+	FpsStats stats;
+	stats.itrTime       = static_cast<float>(m_frameIntervalMSec.load());
+	stats.maxFPS        = m_maxFPS.load();
+	stats.droppedFrames = m_frameBatcher->GetDroppedCount() + m_inference->GetDroppedCount();
+	stats.skippedFrames = m_skippedFrames.load();
+	stats.staleFrames   = m_staleFrames.load();
+	stats.queueAgeMSec  = m_queueAgeMSec.load();
+
+	if (m_tileLayout.IsTiled())
+	{
+		stats.tiling    = m_tileLayout.GetName();
+		stats.tiles     = m_tileLayout.GetTileCount();
+		stats.inferMSec = m_inference->GetInferenceMSec();
+	}
+
+	if (m_streams.size() > 1)
+	{
+		const uint64_t batches = m_inference->GetBatches() - m_batchesReported;
+		const uint64_t frames  = m_inference->GetBatchedFrames() - m_batchedFramesReported;
+		m_batchesReported += batches;
+		m_batchedFramesReported += frames;
+
+		stats.streams   = static_cast<uint32_t>(m_streams.size());
+		stats.batchSize = (batches > 0) ? static_cast<float>(frames) / static_cast<float>(batches) : 0.0f;
+	}
+
+	// Fraction of the report period every device was busy with inference, the busiest model per device index
+	const std::size_t devices = m_networks.front()->stages.size();
+	if (devices > 1)
+	{
+		for (std::size_t d = 0; d < devices; d++)
+		{
+			double utilization = 0.0;
+			for (const auto &network : m_networks)
+			{
+				NetworkContext::DeviceStage &stage = *network->stages[d];
+				const double busyMSec              = stage.busyMSec.load();
+				utilization                        = std::max(utilization, (busyMSec - stage.busyReportedMSec) / elapsedTime);
+				stage.busyReportedMSec             = busyMSec;
+			}
+			stats.deviceUtilization.push_back(static_cast<float>(std::min(utilization, 1.0)));
+		}
+	}
+
+	for (auto &stream : m_streams)
+	{
+		const uint64_t frameCnt = stream->frameCnt.exchange(0);
+		stats.fps               = static_cast<float>(frameCnt * ONE_SECOND / elapsedTime);
+
+		if (m_motionGating)
+		{
+			const uint64_t motionSkipped = stream->motionSkippedFrames.load() - stream->motionSkippedReported;
+			stream->motionSkippedReported += motionSkipped;
+
+			stats.motionGating      = true;
+			stats.motionSensitivity = stream->motionGate.GetSensitivity();
+			stats.motionSkipRatio   = (motionSkipped + frameCnt > 0) ? static_cast<float>(motionSkipped) / static_cast<float>(motionSkipped + frameCnt) : 0.0f;
+			stats.motionSavedMSec   = static_cast<double>(motionSkipped) * m_inference->GetInferenceMSec();
+		}
+
+		for (auto &model : stream->models)
+			PrintFPS(*model, stats);
+	}
+}
 
-	if (fps == 0.0f)
-			str << string_format("{\"%s\": 0.0}", m_FPS_STR.c_str());
-	else
-		str << string_format("{\"%s\": %.2f, \"lastCurrMSec\": %.2f, \"maxFPS\": %.2f, \"%s\": %llu }", m_FPS_STR.c_str(), fps, itrTime, m_maxFPS, m_AMOUNT_STR.c_str(), m_lastTrackings.size());
+void DetectionNodeHailo8::PrintFPS(ModelContext &model, FpsStats stats)
+{
+	stats.amount = model.tracks->GetTrackCount();
 
 	auto message = std_msgs::msg::String();
-	message.data = str.str();
+	WriteFpsJson(message.data, model.FPS_STR, model.AMOUNT_STR, stats);
 
 	auto power_message = std_msgs::msg::String();
-	power_message.data = std::to_string(m_pYoloHailo8->GetAveragePower());
+	// Sum over the devices the model is loaded on. The detectors are not known to be thread-safe,
+	// so the query waits for the batch in flight on the device like the inference workers do.
+	float power = 0.0f;
+	for (std::size_t d = 0; d < model.network->detectors.size(); d++)
+	{
+		std::lock_guard<std::mutex> lock(model.network->stages[d]->mutex);
+		power += model.network->detectors[d]->GetAveragePower();
+	}
+	power_message.data = std::to_string(power);
 	
 	try{
-		m_fps_publisher->publish(message);
-		m_power_publisher->publish(power_message);
+		model.fps_publisher->publish(message);
+		model.power_publisher->publish(power_message);
 	}
   	catch (...) {
     	RCLCPP_INFO(this->get_logger(), "m_fps_publisher: hmm publishing dets has failed!! ");
@@ -354,6 +1015,8 @@ void DetectionNodeHailo8::PrintFPS(const float fps, const float itrTime)
 
 		
 	if (m_print_fps)
-		RCLCPP_INFO(this->get_logger(), message.data.c_str());
+		RCLCPP_INFO(this->get_logger(), "%s", message.data.c_str());
 
 }
+
+RCLCPP_COMPONENTS_REGISTER_NODE(DetectionNodeHailo8)
@@ -71,8 +71,8 @@ int main(int argc, char** argv)
 	//image_node->setExitSignal(&exit_request);
 	obj_det_node->init();
 
-	//rclcpp::executors::MultiThreadedExecutor executor(rclcpp::ExecutorOptions(), 2, false);
-	rclcpp::executors::SingleThreadedExecutor executor;
+	// One thread per callback group: images, parameter services and telemetry
+	rclcpp::executors::MultiThreadedExecutor executor(rclcpp::ExecutorOptions(), 3);
 	executor.add_node(obj_det_node);
 	//rclcpp::spin(obj_det_node);
 	executor.spin();
@@ -0,0 +1,428 @@
+// Heap allocations of the frame path, from the detector output to the filled outgoing messages.
+//
+// The global operator new of this executable counts every allocation, on every thread. The test
+// runs the classes of DetectionNodeHailo8 (FramePath.h): InferenceStage with its worker, model
+// threads, pooled result sets and the bounded queue to the tracking stage (with displaced results),
+// and ModelTracks with tracking, change detection, keyframes, extrapolated frames and the fill of
+// the reused messages. Receiving the image and publishing need a running ROS graph and are not
+// part of it.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sensor_msgs/msg/image.hpp>
+#include <sm_interfaces/msg/string_stamped.hpp>
+#include <std_msgs/msg/string.hpp>
+
+#include "Detector.h"
+#include "FramePath.h"
+
+static std::atomic<uint64_t> s_allocations{0};
+
+void* operator new(std::size_t size)
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+
+/**
+ * @brief Detector with objects moving through the frame, a fraction of them is replaced every frame.
+ */
+class ChurnDetector : public Detector
+{
+	struct Object
+	{
+		uint32_t classID;
+		float x, y, w, h;
+		float vx, vy;
+	};
+
+public:
+	ChurnDetector(const std::size_t& objectCount, const double& churnPercent, const uint32_t& seed) :
+		m_churn(churnPercent / 100.0),
+		m_rng(seed),
+		m_objects(),
+		m_classNames()
+	{
+		for (std::size_t i = 0; i < 80; i++)
+			m_classNames.push_back("class" + std::to_string(i));
+
+		for (std::size_t i = 0; i < objectCount; i++)
+			m_objects.push_back(newObject());
+	}
+
+	Detections Infer(cv::Mat& img) override
+	{
+		Detections dets;
+		InferInto(img, dets);
+		return dets;
+	}
+
+	void InferInto(cv::Mat& img, Detections& dets) override
+	{
+		(void)img;
+
+		step();
+		fill(dets);
+	}
+
+	// The tiles of a frame see the same scene, it moves once per call
+	void InferBatch(std::vector<cv::Mat>& imgs, std::vector<Detections>& results) override
+	{
+		step();
+
+		results.resize(imgs.size());
+		for (Detections& dets : results)
+			fill(dets);
+	}
+
+	const std::vector<std::string>& GetClassNames() const override
+	{
+		return m_classNames;
+	}
+
+private:
+	void step()
+	{
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+		for (Object& obj : m_objects)
+		{
+			if (chance(m_rng) < m_churn)
+				obj = newObject();
+
+			obj.x = std::clamp(obj.x + obj.vx, 0.0f, 1.0f - obj.w);
+			obj.y = std::clamp(obj.y + obj.vy, 0.0f, 1.0f - obj.h);
+			if (obj.x <= 0.0f || obj.x >= 1.0f - obj.w) obj.vx = -obj.vx;
+			if (obj.y <= 0.0f || obj.y >= 1.0f - obj.h) obj.vy = -obj.vy;
+		}
+	}
+
+	void fill(Detections& dets) const
+	{
+		dets.clear();
+		for (const Object& obj : m_objects)
+			dets.push_back({ obj.classID, obj.x, obj.y, obj.w, obj.h, 0.9f });
+	}
+
+	Object newObject()
+	{
+		std::uniform_real_distribution<float> pos(0.0f, 0.8f);
+		std::uniform_real_distribution<float> size(0.05f, 0.15f);
+		std::uniform_real_distribution<float> vel(-0.01f, 0.01f);
+		std::uniform_int_distribution<uint32_t> cls(1, static_cast<uint32_t>(m_classNames.size()));
+
+		return { cls(m_rng), pos(m_rng), pos(m_rng), size(m_rng), size(m_rng), vel(m_rng), vel(m_rng) };
+	}
+
+private:
+	double m_churn;
+	std::mt19937 m_rng;
+	std::vector<Object> m_objects;
+	std::vector<std::string> m_classNames;
+};
+
+/**
+ * @brief One camera and two models run through the frame path classes as by DetectionNodeHailo8,
+ * with the outgoing messages reused as when the middleware does not loan them.
+ */
+class TestPipeline
+{
+	static constexpr uint32_t IMAGE_WIDTH  = 320;
+	static constexpr uint32_t IMAGE_HEIGHT = 240;
+	static constexpr int IMAGE_SIZE        = 64;
+	static constexpr std::size_t MODELS    = 2;
+	static constexpr float HYSTERESIS      = 0.005f;
+
+	/**
+	 * @brief Reused outgoing messages of one model, as in DetectionNodeHailo8::ModelContext.
+	 */
+	struct Outputs
+	{
+		detection_interfaces::msg::DetectionArray array;
+		detection_interfaces::msg::DetectionDelta delta;
+		std_msgs::msg::String json;
+		sm_interfaces::msg::StringStamped jsonStamped;
+	};
+
+public:
+	/**
+	 * @param objects Objects of the scene, detections per network input
+	 * @param churnPercent Percentage of the objects replaced every frame
+	 * @param tileCols Columns of the tile layout, with the full view as an extra tile if tiled
+	 * @param keyframeInterval Frames between two keyframes
+	 */
+	TestPipeline(const std::size_t& objects, const double& churnPercent, const uint32_t& tileCols, const uint32_t& keyframeInterval) :
+		m_networks(),
+		m_latency(),
+		m_tileLayout(tileCols, 1, 0.2f, true),
+		m_inference(),
+		m_tracks(),
+		m_outputs(MODELS),
+		m_image(std::make_shared<sensor_msgs::msg::Image>()),
+		m_encoding(),
+		m_job(),
+		m_keyframeInterval(keyframeInterval)
+	{
+		for (std::size_t i = 0; i < MODELS; i++)
+		{
+			auto network       = std::make_unique<NetworkContext>();
+			network->name      = "model" + std::to_string(i);
+			network->imageSize = IMAGE_SIZE;
+			network->devices   = { "mock" };
+			network->detectors.push_back(std::make_unique<ChurnDetector>(objects, churnPercent, static_cast<uint32_t>(42 + i)));
+			network->stages.push_back(std::make_unique<NetworkContext::DeviceStage>());
+			network->classNames = network->detectors.front()->GetClassNames();
+
+			// tracking_capacity, detections of all tiles may survive the merge
+			network->detectionCapacity = 2 * objects * m_tileLayout.GetTileCount();
+			m_networks.push_back(std::move(network));
+		}
+
+		m_inference = std::make_unique<InferenceStage>(m_networks, 1, 1, m_tileLayout, true, 0, 0.5f, m_latency);
+
+		for (std::size_t i = 0; i < MODELS; i++)
+		{
+			m_tracks.push_back(std::make_unique<ModelTracks>(*m_networks[i], false, "DETECTED_OBJECTS", "DETECTED_OBJECTS_AMOUNT", m_latency));
+
+			const ModelTracks& tracks = *m_tracks.back();
+			ReserveDetectionArray(m_outputs[i].array, tracks.GetTrackCapacity());
+			ReserveDetectionDelta(m_outputs[i].delta, tracks.GetTrackCapacity());
+			m_outputs[i].json.data.reserve(tracks.GetJsonCapacity());
+			m_outputs[i].jsonStamped.data.reserve(tracks.GetJsonCapacity());
+		}
+
+		m_image->header.frame_id = "camera";
+		m_image->width           = IMAGE_WIDTH;
+		m_image->height          = IMAGE_HEIGHT;
+		m_image->encoding        = "rgb8";
+		m_image->step            = 3 * IMAGE_WIDTH;
+		m_image->data.resize(static_cast<std::size_t>(m_image->step) * IMAGE_HEIGHT);
+		for (std::size_t i = 0; i < m_image->data.size(); i++)
+			m_image->data[i] = static_cast<uint8_t>(i * 7);
+
+		Preprocessor::ParseEncoding(m_image->encoding, m_encoding);
+	}
+
+	/**
+	 * @brief Process one camera frame.
+	 * @param predicted The frame is skipped by the rate limit, the tracks are extrapolated
+	 * @param dropped The tracking stage falls behind, the results of earlier frames are displaced by this one
+	 */
+	void Frame(const bool& predicted, const bool& dropped)
+	{
+		m_image->header.stamp.nanosec += 1000;
+
+		if (predicted)
+		{
+			// Batches of predicted frames only are delivered without running a worker
+			InferenceBatch batch = m_inference->AcquireBatch();
+			batch.push_back({ nullptr, m_encoding, job(true) });
+			m_inference->Deliver(batch, neverStale);
+		}
+		else
+		{
+			// The queue holds two frames per stream, a third one displaces the oldest
+			for (int i = 0; i < (dropped ? 3 : 1); i++)
+			{
+				InferenceBatch batch = m_inference->AcquireBatch();
+				batch.push_back({ m_image, m_encoding, job(false) });
+				m_inference->Process(0, batch);
+				m_displaced += m_inference->Deliver(batch, neverStale);
+			}
+		}
+
+		while (m_inference->GetQueuedCount() > 0)
+			track();
+	}
+
+	uint64_t GetKeyframes() const
+	{
+		return m_keyframes;
+	}
+
+	uint64_t GetRemoved() const
+	{
+		return m_removed;
+	}
+
+	uint64_t GetDisplaced() const
+	{
+		return m_displaced;
+	}
+
+	std::size_t GetTrackCount() const
+	{
+		return m_tracks.front()->GetTrackCount();
+	}
+
+	const std::string& GetJson() const
+	{
+		return m_outputs.front().json.data;
+	}
+
+private:
+	static bool neverStale(const DetectionJob&)
+	{
+		return false;
+	}
+
+	// As built by DetectionNodeHailo8::inferenceLoop
+	DetectionJob job(const bool& predicted) const
+	{
+		DetectionJob job;
+		job.stream       = 0;
+		job.frame.header = m_image->header;
+		job.frame.width  = m_image->width;
+		job.frame.height = m_image->height;
+		job.received     = std::chrono::high_resolution_clock::now();
+		job.predicted    = predicted;
+		return job;
+	}
+
+	// DetectionNodeHailo8::trackingLoop, ProcessDetections and ProcessPrediction without the publisher calls
+	void track()
+	{
+		ASSERT_TRUE(m_inference->Pop(m_job));
+
+		for (std::size_t i = 0; i < MODELS; i++)
+		{
+			ModelTracks& tracks              = *m_tracks[i];
+			const TrackDelta::Events* events = m_job.predicted ? tracks.Extrapolate(0.5f, HYSTERESIS, m_keyframeInterval)
+															   : tracks.Update(m_job.results[i], HYSTERESIS, m_keyframeInterval);
+			if (!events)
+				continue;
+
+			m_keyframes += events->keyframe ? 1 : 0;
+			m_removed += events->removed.size();
+
+			Outputs& out = m_outputs[i];
+			tracks.FillArray(out.array, m_job.frame);
+			tracks.WriteJson(out.jsonStamped.data);
+			out.jsonStamped.header = m_job.frame.header;
+			out.json.data.swap(out.jsonStamped.data);
+			tracks.FillDelta(out.delta, m_job.frame, *events);
+		}
+
+		m_inference->Release(m_job);
+	}
+
+private:
+	Networks m_networks;
+	StageLatencies m_latency;
+	TileLayout m_tileLayout;
+	std::unique_ptr<InferenceStage> m_inference;
+	std::vector<std::unique_ptr<ModelTracks>> m_tracks;
+	std::vector<Outputs> m_outputs;
+
+	sensor_msgs::msg::Image::SharedPtr m_image;
+	Preprocessor::Encoding m_encoding;
+	DetectionJob m_job;
+	uint32_t m_keyframeInterval;
+
+	uint64_t m_keyframes = 0;
+	uint64_t m_removed   = 0;
+	uint64_t m_displaced = 0;
+};
+
+struct ChurnParam
+{
+	std::size_t objects;
+	double churnPercent;
+	uint32_t tileCols;
+};
+
+void PrintTo(const ChurnParam& param, std::ostream* os)
+{
+	*os << param.objects << " objects, " << param.churnPercent << "% churn, " << param.tileCols << " tile columns";
+}
+
+class FramePathAllocations : public ::testing::TestWithParam<ChurnParam>
+{
+};
+
+} // namespace
+
+TEST(AllocationCounter, CountsAllocations)
+{
+	const uint64_t before = s_allocations.load();
+	std::vector<int>* v   = new std::vector<int>(16);
+	const uint64_t after  = s_allocations.load();
+	delete v;
+
+	EXPECT_EQ(after - before, 2u);
+}
+
+TEST_P(FramePathAllocations, NoAllocationsAfterWarmup)
+{
+	constexpr int WARMUP_FRAMES   = 100;
+	constexpr int MEASURED_FRAMES = 3000;
+
+	const ChurnParam param = GetParam();
+	TestPipeline pipeline(param.objects, param.churnPercent, param.tileCols, 5);
+
+	// Every third frame is skipped by the rate limit, every seventh one displaces the results of earlier ones
+	auto frame = [&pipeline](const int& i) { pipeline.Frame(i % 3 == 2, i % 7 == 6); };
+
+	for (int i = 0; i < WARMUP_FRAMES; i++)
+		frame(i);
+
+	uint64_t allocations = 0;
+	for (int i = WARMUP_FRAMES; i < WARMUP_FRAMES + MEASURED_FRAMES; i++)
+	{
+		const uint64_t before = s_allocations.load(std::memory_order_relaxed);
+		frame(i);
+		allocations += s_allocations.load(std::memory_order_relaxed) - before;
+	}
+
+	EXPECT_EQ(allocations, 0u);
+
+	// The paths in question have actually been taken
+	EXPECT_GT(pipeline.GetKeyframes(), 0u);
+	EXPECT_GT(pipeline.GetRemoved(), 0u);
+	EXPECT_GT(pipeline.GetDisplaced(), 0u);
+	EXPECT_GT(pipeline.GetTrackCount(), 0u);
+	EXPECT_FALSE(pipeline.GetJson().empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(Churn, FramePathAllocations,
+						 ::testing::Values(ChurnParam{ 10, 1.0, 1 }, ChurnParam{ 40, 2.0, 1 }, ChurnParam{ 100, 5.0, 1 }, ChurnParam{ 20, 2.0, 2 }));